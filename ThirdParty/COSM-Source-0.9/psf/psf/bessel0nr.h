@@ -24,6 +24,7 @@
 #define _BESSEL_0_NR_H
 
 #include "functor.h"
+#include "sinCos.h"
 #include <math.h>
 
 namespace cosm {
@@ -65,6 +66,35 @@ class J0nr : public Functor<T> {
         return ans;
     }
 
+    // Same as above for n values of x. Both fits are evaluated and the
+    // result selected so that the loop has no branches and vectorizes.
+    virtual void evaluate( const T* x, T* y, int n ) 
+    {
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    T xabs = x[i] < 0 ? -x[i] : x[i];
+	    T yy = x[i]*x[i];
+	    T ans1 = T(57568490574.0)+yy*(-T(13362590354.0)+yy*(T(651619640.7)
+		   + yy*(-T(11214424.18)+yy*(T(77392.33017)+yy*(-T(184.9052456))))));
+	    T ans2 = T(57568490411.0)+yy*(T(1029532985.0)+yy*(T(9494680.718)
+		   + yy*(T(59272.64853)+yy*(T(267.8532712)+yy*T(1.0)))));
+	    T small = ans1/ans2;
+
+	    T xl = xabs < 8 ? T(8) : xabs;
+	    T z = T(8.0)/xl;
+	    T zz = z*z;
+	    T s;
+	    T c;
+	    sinCos(xl-T(0.785398164), s, c);
+	    T ans3 = T(1.0)+zz*(-T(0.1098628627e-2)+zz*(T(0.2734510407e-4)
+		   + zz*(-T(0.2073370639e-5)+zz*T(0.2093887211e-6))));
+	    T ans4 = -T(0.1562499995e-1)+zz*(T(0.1430488765e-3)
+		   + zz*(-T(0.6911147651e-5)+zz*(T(0.7621095161e-6)-zz*T(0.934945152e-7))));
+	    T large = sqrt(T(0.636619772)/xl)*(c*ans3-z*s*ans4);
+	    y[i] = xabs < 8 ? small : large;
+	}
+    }
+
   protected:
 
     // not allowed
@@ -57,7 +57,7 @@ class BilinearInterpolator : public Interpolator<T> {
 	    std::cout <<"x: "<<x<<", ns: "<<ns<<" x["<<i<<"]="<<this->x_[i]<<std::endl;
 	    return 0;
 	}
-	return  (this->y_[ns+1] * (this->x_[ns+1]-x) + this->y_[ns] * (x-this->x_[ns]))/(this->x_[ns+1]-this->x_[ns]);
+	return  (this->y_[ns] * (this->x_[ns+1]-x) + this->y_[ns+1] * (x-this->x_[ns]))/(this->x_[ns+1]-this->x_[ns]);
     };
 
     virtual void setValues( T x[], T y[], int n) { 
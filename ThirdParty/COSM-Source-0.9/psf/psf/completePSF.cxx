@@ -17,174 +17,266 @@
  *
  ****************************************************************************/
 
+#include <algorithm>
+#include <vector>
+
 namespace cosm {
 
 template<typename T>
 void CompletePSF<T>::rotate(
     bool exact,
-	EvalType type,
+	unsigned short evalType,
     PsfUser* user
 ){
-    Range all = Range::all();
-    int nZ = radialPSF_->nZ();
-    int nXY = radialPSF_->nXY();
-    int nXYHalf = nXY/2;
-    int nZHalf = nZ/2;
-    Array<T,2> rotatedXY(nXY, nXY);
-	switch (type)
-	{
-        case MAGNITUDE: psf_.resize(nZ, nXY, nXY);
-	    case REAL: psfReal_.resize(nZ, nXY, nXY);
-	    case IMAGINARY: psfImag_.resize(nZ, nXY, nXY);
-	}
-    int maxZ = radialPSF_->isSymmetric() ? nZHalf : nZ-1;
-    for ( int z = 0; z <= maxZ; z++ ) 
-    {   
-	for ( int y = 0; y <= nXYHalf; y++ )
-	{
-	    for ( int x = 0; x <= y; x++ )
-	    {
-		    T value = (exact ) ? 
-			    radialPSF_->exactValue(z,y,x, type) : 
-			    radialPSF_->interpolatedValue(z,y,x, type);
-
-		    rotatedXY(y,x) = value;
-		    rotatedXY(x,y) = value;
-
-		    if ( x > 0 )
-			{
-				rotatedXY(y,nXY-x) = value;
-  		        rotatedXY(nXY-x,y) = value;
-		    }
-	 	    if ( y > 0 )
-	    	{
-		        rotatedXY(x,nXY-y) = value;
-		        rotatedXY(nXY-y,x) = value;
-		    }
-		    if ( y > 0 && x > 0 )
-		    {
-		        rotatedXY(nXY-y,nXY-x) = value;
-		        rotatedXY(nXY-x,nXY-y) = value;
-		    }
-	    }
-	}
-	switch (type )
-	{
-	    case MAGNITUDE:  psf_( z, all, all) = rotatedXY;
-		case REAL: psfReal_( z, all, all) = rotatedXY;
-		case IMAGINARY: psfImag_( z, all, all) = rotatedXY;
-	}
-	if ( radialPSF_->isSymmetric() && z > 0 ) 
-	{
-	    switch (type)
-		{
-		    case MAGNITUDE: psf_(nZ-z, all, all) = rotatedXY;
-	            case REAL: psfReal_(nZ-z, all, all) = rotatedXY;
-		    case IMAGINARY: psfImag_(nZ-z, all, all) = 0 - rotatedXY;
-		}
-	}	
-	if ( user != NULL )
-	{
-	    user->update(PsfUser::COMPLETE, z, maxZ);
-	}
-    }
-//    T maxVal = max(psf_);
-//    psf_ /= maxVal;
-    switch (type)
-	{
-	    case MAGNITUDE: psf_ /= sum(psf_);
-		default: break;
-	}
+    rotatePlanes(1, exact, evalType, user);
 };
 
 template<typename T>
 void CompletePSF<T>::rotateAndSum(
     bool exact,
-	EvalType type,
+	unsigned short evalType,
+    PsfUser* user
+){
+    rotatePlanes(exact ? 1 : radialPSF_->oversampling(), exact, evalType, user);
+};
+
+template<typename T>
+void CompletePSF<T>::rotatePlanes(
+    int oversampling,
+    bool exact,
+	unsigned short evalType,
     PsfUser* user
 ){
-    Range all = Range::all();
-    int oversampling = exact ? 1 : radialPSF_->oversampling();
     int sq = oversampling * oversampling;
     int nZ = radialPSF_->nZ();
     int nXY = radialPSF_->nXY();
     int nXYHalf = nXY/2;
     int nZHalf = nZ/2;
-    Array<T,2> rotatedXY(nXY, nXY);
-	switch (type)
-	{
-        case MAGNITUDE: psf_.resize(nZ, nXY, nXY);
-	    case REAL: psfReal_.resize(nZ, nXY, nXY);
-	    case IMAGINARY: psfImag_.resize(nZ, nXY, nXY);
-	}
+    // the requested channels, filled in the same pass
+    Array<T,3>* outputs[3];
+    EvalType types[3];
+    int nChannels = 0;
+    if ( (evalType & MAGNITUDE) == MAGNITUDE ) 
+    {
+        outputs[nChannels] = &psf_;
+        types[nChannels++] = MAGNITUDE;
+    }
+    if ( (evalType & REAL) == REAL ) 
+    {
+        outputs[nChannels] = &psfReal_;
+        types[nChannels++] = REAL;
+    }
+    if ( (evalType & IMAGINARY) == IMAGINARY ) 
+    {
+        outputs[nChannels] = &psfImag_;
+        types[nChannels++] = IMAGINARY;
+    }
+    for ( int c = 0; c < nChannels; c++ )
+    {
+        outputs[c]->resize(nZ, nXY, nXY);
+    }
+    T deltaSq = radialPSF_->deltaXY() * radialPSF_->deltaXY();
     int maxZ = radialPSF_->isSymmetric() ? nZHalf : nZ-1;
+    // the planes are independent; the exact values need a functor per
+    // thread, the interpolated ones only read the radial PSF
+    int threads = exact ? radialPSF_->threads() : maxThreads();
+    // the sub-samples of a pixel are at the same radii in every plane,
+    // so their interpolation weights are summed once for all planes
+    std::vector<int> first;
+    std::vector<int> offset;
+    std::vector<T> weights;
+    if ( !exact )
+    {
+        radialWeights(oversampling, first, offset, weights);
+    }
+    const T* w = weights.empty() ? NULL : &weights[0];
+    int completed = 0;
+    int reported = -1;
+#pragma omp parallel num_threads(threads)
+    {
+    int thread = threadNumber();
+    std::vector<T> rotatedXY(3*nXY*nXY);
+    std::vector<T> radii;
+    std::vector< complex<T> > values;
+#pragma omp for schedule(dynamic)
     for ( int z = 0; z <= maxZ; z++ ) 
     {   
+        const T* slices[3];
+        if ( exact )
+        {
+            // evaluate all samples of the octant of the plane as one batch
+            radii.clear();
+            for ( int y = 0; y <= nXYHalf; y++ )
+            {
+                for ( int x = 0; x <= y; x++ )
+                {
+                    for ( int i = 0; i < oversampling; i++ ) 
+                    {
+                        for ( int j = 0; j < oversampling; j++ ) 
+                        {
+                            int ys = y*oversampling+i;
+                            int xs = x*oversampling+j;
+                            radii.push_back(sqrt(ys*ys*deltaSq+xs*xs*deltaSq));
+                        }
+                    }
+                }
+            }
+            values.resize(radii.size());
+            radialPSF_->exactValues(z, &radii[0], &values[0], int(radii.size()), thread);
+        }
+        else
+        {
+            for ( int c = 0; c < nChannels; c++ )
+            {
+                slices[c] = radialPSF_->slice(z, types[c]);
+            }
+        }
+        int sample = 0;
+        int pixel = 0;
         for ( int y = 0; y <= nXYHalf; y++ )
         {
             for ( int x = 0; x <= y; x++ )
             {
-                T sum = 0;
-                for ( int i = 0; i < oversampling; i++ ) 
+                for ( int c = 0; c < nChannels; c++ )
                 {
-                    for ( int j = 0; j < oversampling; j++ ) 
+                    T value = 0;
+                    if ( exact )
                     {
-                        sum += exact ?
-                            radialPSF_->exactValue(z,y*oversampling+i,x*oversampling+j, type) :
-                            radialPSF_->interpolatedValue(z, y*oversampling+i, x*oversampling+j, oversampling, type);
+                        T sum = 0;
+                        for ( int i = 0; i < sq; i++ ) 
+                        {
+                            complex<T> psf = values[sample+i];
+                            switch ( types[c] )
+                            {
+                                case MAGNITUDE: sum += norm(psf); break;
+                                case REAL: sum += real(psf); break;
+                                case IMAGINARY: sum += imag(psf); break;
+                            }
+                        }
+                        value = sum/sq;
                     }
-		        }
-		        T value = sum/sq;
-
-		        rotatedXY(y,x) = value;
-		        rotatedXY(x,y) = value;
-		        if ( x > 0 )
-		        {
-		            rotatedXY(y,nXY-x) = value;
-  		            rotatedXY(nXY-x,y) = value;
-		        }
-		        if ( y > 0 )
-		        {
-		            rotatedXY(x,nXY-y) = value;
-		            rotatedXY(nXY-y,x) = value;
-		        }
-		        if ( y > 0 && x > 0 )
-		        {
-		            rotatedXY(nXY-y,nXY-x) = value;
-		            rotatedXY(nXY-x,nXY-y) = value;
-		        }
+                    else
+                    {
+                        value = gather(slices[c], pixel, first, offset, w);
+                    }
+                    setOctant(&rotatedXY[c*nXY*nXY], nXY, y, x, value);
+                }
+                sample += sq;
+                pixel++;
+            }
+        }
+        for ( int c = 0; c < nChannels; c++ )
+        {
+            const T* rotated = &rotatedXY[c*nXY*nXY];
+            setPlane(*outputs[c], z, rotated);
+            // the middle plane of an even number of planes is its own
+            // mirror
+            if ( radialPSF_->isSymmetric() && z > 0 && nZ-z != z ) 
+            {
+                setPlane(*outputs[c], nZ-z, rotated, types[c] == IMAGINARY ? T(-1) : T(1));
+            }
+        }
+        if ( user != NULL )
+        {
+            int count;
+#pragma omp critical(cosm_psf_user)
+            count = completed++;
+            // the user may not be thread safe, only the calling
+            // (master) thread reports progress
+            if ( threadNumber() == 0 )
+            {
+                user->update(PsfUser::COMPLETE, count, maxZ);
+                reported = count;
             }
         }
-        switch (type )
-	    {
-	        case MAGNITUDE:  psf_( z, all, all) = rotatedXY;
-		    case REAL: psfReal_( z, all, all) = rotatedXY;
-		    case IMAGINARY: psfImag_( z, all, all) = rotatedXY;
-	    }
-
-	    if ( radialPSF_->isSymmetric() && z > 0 ) 
-	    {
-	        switch (type)
-		    {
-		        case MAGNITUDE: psf_(nZ-z, all, all) = rotatedXY;
-	            case REAL: psfReal_(nZ-z, all, all) = rotatedXY;
-			    case IMAGINARY: psfImag_(nZ-z, all, all) = 0 - rotatedXY;
-		    }
-	    }
-	    if ( user != NULL )
-	    {
-	        user->update(PsfUser::COMPLETE, z, maxZ);
-	    }
+    }
+    }
+    if ( user != NULL && reported != maxZ )
+    {
+        user->update(PsfUser::COMPLETE, maxZ, maxZ);
     }
 //    T maxVal = (max)(psf_);
 //    psf_ /= maxVal;
-      switch (type)
-      {
-	    case MAGNITUDE: psf_ /= sum(psf_);
-		default: break;
-      }
+    if ( (evalType & MAGNITUDE) == MAGNITUDE ) 
+    {
+        psf_ /= sum(psf_);
+    }
 };
 
+template<typename T>
+void CompletePSF<T>::radialWeights(
+    int oversampling,
+    std::vector<int>& first,
+    std::vector<int>& offset,
+    std::vector<T>& weights
+) {
+    int nXYHalf = radialPSF_->nXY()/2;
+    int nSub = oversampling * oversampling;
+    T sq = (radialPSF_->deltaXY() * radialPSF_->deltaXY())/T(nSub);
+    std::vector<int> bins(nSub);
+    std::vector<T> w0(nSub);
+    std::vector<T> w1(nSub);
+    first.clear();
+    offset.assign(1, 0);
+    weights.clear();
+    for ( int y = 0; y <= nXYHalf; y++ )
+    {
+        for ( int x = 0; x <= y; x++ )
+        {
+            int lo = 0;
+            int hi = -1;
+            for ( int i = 0; i < oversampling; i++ ) 
+            {
+                for ( int j = 0; j < oversampling; j++ ) 
+                {
+                    int ys = y*oversampling+i;
+                    int xs = x*oversampling+j;
+                    int k = i*oversampling+j;
+                    radialPSF_->interpolationWeights(sqrt(ys*ys*sq+xs*xs*sq), bins[k], w0[k], w1[k]);
+                    if ( w0[k] != 0 || w1[k] != 0 ) 
+                    {
+                        lo = hi < 0 ? bins[k] : std::min(lo, bins[k]);
+                        hi = std::max(hi, bins[k]+1);
+                    }
+                }
+            }
+            int base = int(weights.size());
+            if ( hi >= 0 )
+            {
+                weights.resize(base + hi-lo+1, T(0));
+                for ( int k = 0; k < nSub; k++ )
+                {
+                    if ( w0[k] != 0 || w1[k] != 0 ) 
+                    {
+                        weights[base + bins[k]-lo] += w0[k]/nSub;
+                        weights[base + bins[k]+1-lo] += w1[k]/nSub;
+                    }
+                }
+            }
+            first.push_back(hi >= 0 ? lo : 0);
+            offset.push_back(int(weights.size()));
+        }
+    }
+}
+
+template<typename T>
+void CompletePSF<T>::setPlane(
+    Array<T,3>& psf,
+    int z,
+    const T* plane,
+    T sign
+) {
+    int nXY = psf.length(1);
+    T* out = psf.data() + z*psf.stride(0);
+    for ( int y = 0; y < nXY; y++ )
+    {
+        for ( int x = 0; x < nXY; x++ )
+        {
+            out[y*psf.stride(1) + x*psf.stride(2)] = sign*plane[y*nXY+x];
+        }
+    }
+}
+
 template<typename T>
 void CompletePSF<T>::sumY(
     void
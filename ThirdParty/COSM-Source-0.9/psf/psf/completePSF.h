@@ -22,7 +22,9 @@
 
 #include "psf/radialPSF.h"
 #include "psf/psfUser.h"
+#include "psf/psfThreads.h"
 #include <blitz/array.h>
+#include <vector>
 
 using namespace blitz;
 
@@ -49,8 +51,11 @@ class CompletePSF  {
 
     virtual ~CompletePSF(){};
 
-    virtual void rotate( bool exact = false, EvalType type = MAGNITUDE, PsfUser* user = NULL );
-    virtual void rotateAndSum( bool exact = false, EvalType type = MAGNITUDE, PsfUser* user = NULL );
+    // The evalType is a combination of MAGNITUDE, REAL and IMAGINARY.
+    // All the requested channels are filled in a single pass over the
+    // planes, sharing the radii and the interpolation weights.
+    virtual void rotate( bool exact = false, unsigned short evalType = MAGNITUDE, PsfUser* user = NULL );
+    virtual void rotateAndSum( bool exact = false, unsigned short evalType = MAGNITUDE, PsfUser* user = NULL );
     void sumY( void );
 	virtual void rotateXY( double angle ) {};
 
@@ -64,6 +69,62 @@ class CompletePSF  {
     CompletePSF(CompletePSF<T>&);
     CompletePSF& operator=(CompletePSF<T>&);
 
+  protected:
+
+    // Fills the requested channels from the mean of oversampling^2
+    // sub-samples per pixel
+    void rotatePlanes( int oversampling, bool exact, unsigned short evalType, PsfUser* user );
+
+    // Precomputes, for each pixel of the octant 0 <= x <= y <= nXY/2
+    // in that order, the weights of the radial samples that give the
+    // mean of its oversampling^2 interpolated sub-samples. Pixel p is
+    // the dot product of weights[offset[p]..offset[p+1]) with the
+    // radial samples from first[p] on, in any plane.
+    void radialWeights( int oversampling, std::vector<int>& first, std::vector<int>& offset, std::vector<T>& weights );
+
+    // Mean of the sub-samples of pixel p of the octant in a radial
+    // slice, with the weights from radialWeights()
+    static T gather( const T* slice, int p, const std::vector<int>& first, const std::vector<int>& offset, const T* weights )
+    {
+	const T* w = weights + offset[p];
+	const T* s = slice + first[p];
+	int n = offset[p+1] - offset[p];
+	T sum = 0;
+	for ( int k = 0; k < n; k++ )
+	{
+	    sum += w[k]*s[k];
+	}
+	return sum;
+    };
+
+    // Sets the value of pixel (y, x) of the octant and of its mirror
+    // images in a plane of nXY*nXY values
+    static void setOctant( T* plane, int nXY, int y, int x, T value )
+    {
+	plane[y*nXY+x] = value;
+	plane[x*nXY+y] = value;
+	if ( x > 0 )
+	{
+	    plane[y*nXY+nXY-x] = value;
+	    plane[(nXY-x)*nXY+y] = value;
+	}
+	if ( y > 0 )
+	{
+	    plane[x*nXY+nXY-y] = value;
+	    plane[(nXY-y)*nXY+x] = value;
+	}
+	if ( y > 0 && x > 0 )
+	{
+	    plane[(nXY-y)*nXY+nXY-x] = value;
+	    plane[(nXY-x)*nXY+nXY-y] = value;
+	}
+    };
+
+    // Copies a plane of nXY*nXY values, times sign, to plane z of psf.
+    // Writes through the data pointer so that threads do not share
+    // the reference count of the array.
+    void setPlane( Array<T,3>& psf, int z, const T* plane, T sign = 1 );
+
   protected:
 
     RadialPSF<T>* radialPSF_;
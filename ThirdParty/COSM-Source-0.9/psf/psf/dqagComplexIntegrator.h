@@ -0,0 +1,198 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// Globally adaptive Gauss-Kronrod (10-21 point) integration of a
+// complex valued functor. This follows the strategy of the quadpack
+// dqag routine: the subinterval with the largest error estimate is
+// bisected until the sum of the error estimates drops below
+// max(epsabs, epsrel*|integral|). The real and imaginary parts share
+// the quadrature nodes, and the error is controlled on the modulus of
+// the complex result.
+
+#ifndef _DQAG_COMPLEX_INTEGRATOR_H
+#define _DQAG_COMPLEX_INTEGRATOR_H
+
+#include "integratorComplex.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace cosm {
+
+template<typename T>
+class DqagComplexIntegrator : public IntegratorComplex<T> {
+
+  public:
+
+    DqagComplexIntegrator( FunctorComplex<T>* func, T a, T b, T eps, int limit = 500 )
+	: IntegratorComplex<T>(func, a, b), eps_(eps), limit_(limit), neval_(0), error_(0) {};
+    virtual ~DqagComplexIntegrator() {};
+
+    // Returns integration value of a complex functor over interval [a,b]
+    virtual std::complex<T> operator()()
+    {
+	neval_ = 0;
+	this->ier_ = false;
+	intervals_.clear();
+
+	Interval first;
+	first.a = this->a_;
+	first.b = this->b_;
+	first.result = gaussKronrod(first.a, first.b, first.error);
+	intervals_.push_back(first);
+
+	std::complex<T> result = first.result;
+	T errsum = first.error;
+	while ( errsum > std::max(eps_, eps_ * std::abs(result)) ) 
+	{
+	    if ( int(intervals_.size()) >= limit_ )
+	    {
+		this->ier_ = true;
+		break;
+	    }
+
+	    // bisect the subinterval with the largest error estimate
+	    size_t maxerr = 0;
+	    for ( size_t i = 1; i < intervals_.size(); i++ )
+	    {
+		if ( intervals_[i].error > intervals_[maxerr].error ) 
+		{
+		    maxerr = i;
+		}
+	    }
+	    Interval left = intervals_[maxerr];
+	    Interval right = intervals_[maxerr];
+	    left.b = right.a = (T)0.5 * (left.a + left.b);
+	    left.result = gaussKronrod(left.a, left.b, left.error);
+	    right.result = gaussKronrod(right.a, right.b, right.error);
+
+	    result += left.result + right.result - intervals_[maxerr].result;
+	    errsum += left.error + right.error - intervals_[maxerr].error;
+
+	    // stop if the interval can no longer be split
+	    if ( !(left.a < left.b && right.a < right.b) )
+	    {
+		this->ier_ = true;
+		break;
+	    }
+	    intervals_[maxerr] = left;
+	    intervals_.push_back(right);
+	}
+	error_ = errsum;
+	return result;
+    };
+
+    T errorValue() { return error_; };
+    int evaluations() { return neval_; };
+
+  protected:
+
+    struct Interval {
+	T a;
+	T b;
+	std::complex<T> result;
+	T error;
+    };
+
+    // 10-point Gauss and 21-point Kronrod rules over [a,b]. Same
+    // nodes, weights and error estimate as the quadpack G_K21 routine.
+    std::complex<T> gaussKronrod( T a, T b, T& abserr )
+    {
+	static const T xgk[11] = {
+	    0.99565716302580808074, 0.97390652851717172008,
+	    0.93015749135570822600, 0.86506336668898451073,
+	    0.78081772658641689706, 0.67940956829902440623,
+	    0.56275713466860468334, 0.43339539412924719080,
+	    0.29439286270146019813, 0.14887433898163121088,
+	    0.00000000000000000000 };
+	static const T wgk[11] = {
+	    0.01169463886737187428, 0.03255816230796472748,
+	    0.05475589657435199603, 0.07503967481091995277,
+	    0.09312545458369760554, 0.10938715880229764190,
+	    0.12349197626206585108, 0.13470921731147332593,
+	    0.14277593857706008080, 0.14773910490133849137,
+	    0.14944555400291690566 };
+	static const T wg[5] = {
+	    0.06667134430868813759, 0.14945134915058059315,
+	    0.21908636251598204400, 0.26926671930999635509,
+	    0.29552422471475287017 };
+
+	T centr = (T)0.5 * (a + b);
+	T hlgth = (T)0.5 * (b - a);
+	T dhlgth = std::abs(hlgth);
+
+	std::complex<T> fv1[10], fv2[10];
+	std::complex<T> fc = (*this->func_)(centr);
+	std::complex<T> resg = 0;
+	std::complex<T> resk = fc * wgk[10];
+	T resabs = std::abs(resk);
+	for ( int j = 0; j < 10; j++ )
+	{
+	    T absc = hlgth * xgk[j];
+	    fv1[j] = (*this->func_)(centr - absc);
+	    fv2[j] = (*this->func_)(centr + absc);
+	    std::complex<T> fsum = fv1[j] + fv2[j];
+	    resk += wgk[j] * fsum;
+	    resabs += wgk[j] * (std::abs(fv1[j]) + std::abs(fv2[j]));
+	    if ( j % 2 == 1 ) 
+	    {
+		resg += wg[j/2] * fsum;
+	    }
+	}
+	neval_ += 21;
+
+	std::complex<T> reskh = resk * (T)0.5;
+	T resasc = wgk[10] * std::abs(fc - reskh);
+	for ( int j = 0; j < 10; j++ )
+	{
+	    resasc += wgk[j] * (std::abs(fv1[j] - reskh) + std::abs(fv2[j] - reskh));
+	}
+	resabs *= dhlgth;
+	resasc *= dhlgth;
+	abserr = std::abs((resk - resg) * hlgth);
+	if ( resasc != 0 && abserr != 0 )
+	{
+	    abserr = resasc * std::min((T)1, (T)pow(200 * abserr / resasc, (T)1.5));
+	}
+	if ( resabs > DBL_MIN / (50 * DBL_EPSILON) )
+	{
+	    abserr = std::max((T)(DBL_EPSILON * 50) * resabs, abserr);
+	}
+	return resk * hlgth;
+    };
+
+  protected:
+
+    // not allowed
+    DqagComplexIntegrator(DqagComplexIntegrator<T>&);
+    DqagComplexIntegrator& operator=(DqagComplexIntegrator<T>&);
+
+  protected:
+
+    T eps_;
+    int limit_;
+    int neval_;
+    T error_;
+    std::vector<Interval> intervals_;
+
+};
+
+}
+
+#endif // _DQAG_COMPLEX_INTEGRATOR_H
@@ -33,6 +33,16 @@ class Functor {
     virtual T operator()( T /*x*/ ) { return 0; };
     virtual T operator()( T /*x*/, T /*y*/ ) { return 0; };
     virtual T operator()( T /*x*/, T /*y*/, T /*z*/ ) { return 0; };
+
+    // Evaluates the functor at n points. Subclasses override this to
+    // evaluate all points in one call that the compiler can vectorize.
+    virtual void evaluate( const T* x, T* y, int n ) 
+    {
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    y[i] = (*this)(x[i]);
+	}
+    };
   
   protected:
 
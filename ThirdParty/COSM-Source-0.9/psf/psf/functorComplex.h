@@ -35,6 +35,16 @@ class FunctorComplex {
     virtual std::complex<T> operator()( T /*x*/ ) { return 0; };
     virtual std::complex<T> operator()( T /*x*/, T /*y*/ ) { return 0; };
     virtual std::complex<T> operator()( T /*x*/, T /*y*/, T /*z*/ ) { return 0; };
+
+    // Evaluates the functor at n points. Subclasses override this to
+    // evaluate all points in one call that the compiler can vectorize.
+    virtual void evaluate( const T* x, std::complex<T>* y, int n ) 
+    {
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    y[i] = (*this)(x[i]);
+	}
+    };
   
   protected:
 
@@ -0,0 +1,471 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// Gauss-Legendre quadrature with a fixed number of nodes per panel.
+//
+// The integrand is evaluated at all nodes of a panel in a single
+// call to Functor::evaluate() or FunctorComplex::evaluate(), so the
+// integrand body is a plain loop the compiler can inline and
+// vectorize instead of one virtual call per node.
+//
+// Two modes are supported:
+//   - fixed: [a,b] is split into equal panels whose number is doubled
+//     until the tolerance is met. It never decreases, so the node set
+//     settles and integrands can cache per-node terms. The error
+//     estimate can be turned off once the number has settled.
+//   - adaptive: starting from the fixed panels, the panel with the
+//     largest error estimate is bisected until the total error
+//     estimate meets the tolerance, as dqag does.
+//
+// Sums over many nodes or panels are compensated (Kahan), which keeps
+// single-precision integrands close to the double-precision result.
+
+#ifndef _GAUSS_LEGENDRE_INTEGRATOR_H
+#define _GAUSS_LEGENDRE_INTEGRATOR_H
+
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+
+#include "integrator.h"
+#include "integratorComplex.h"
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace cosm {
+
+// Nodes and weights of the Order-point Gauss-Legendre rule on [-1,1].
+// They are computed on construction by Newton iteration on the
+// Legendre polynomial (Numerical Recipes gauleg). The 16-point rule
+// used by default is tabulated below.
+template<typename T, int Order>
+class GaussLegendreRule {
+
+  public:
+
+    GaussLegendreRule() 
+    {
+	int m = (Order + 1) / 2;
+	for ( int i = 0; i < m; i++ ) 
+	{
+	    double z = cos(M_PI * (i + 0.75) / (Order + 0.5));
+	    double z1 = 0;
+	    double pp = 0;
+	    do {
+		double p1 = 1.0;
+		double p2 = 0.0;
+		for ( int j = 0; j < Order; j++ ) 
+		{
+		    double p3 = p2;
+		    p2 = p1;
+		    p1 = ((2.0 * j + 1.0) * z * p2 - j * p3) / (j + 1);
+		}
+		pp = Order * (z * p1 - p2) / (z * z - 1.0);
+		z1 = z;
+		z = z1 - p1 / pp;
+	    } while ( fabs(z - z1) > 1e-15 );
+	    x_[i] = T(-z);
+	    x_[Order-1-i] = T(z);
+	    w_[i] = w_[Order-1-i] = T(2.0 / ((1.0 - z * z) * pp * pp));
+	}
+    };
+
+    const T* nodes() const { return x_; };
+    const T* weights() const { return w_; };
+
+  private:
+
+    T x_[Order];
+    T w_[Order];
+
+};
+
+template<typename T>
+class GaussLegendreRule<T, 16> {
+
+  public:
+
+    GaussLegendreRule() 
+    {
+	// positive nodes from the outermost inwards and their weights
+	static const double x[8] = {
+	    0.9894009349916499325961542, 0.9445750230732325760779884,
+	    0.8656312023878317438804679, 0.7554044083550030338951012,
+	    0.6178762444026437484466718, 0.4580167776572273863424194,
+	    0.2816035507792589132304605, 0.0950125098376374401853193
+	};
+	static const double w[8] = {
+	    0.0271524594117540948517806, 0.0622535239386478928628438,
+	    0.0951585116824927848099251, 0.1246289712555338720524763,
+	    0.1495959888165767320815017, 0.1691565193950025381893121,
+	    0.1826034150449235888667637, 0.1894506104550684962853967
+	};
+	for ( int i = 0; i < 8; i++ ) 
+	{
+	    x_[i] = T(-x[i]);
+	    x_[15-i] = T(x[i]);
+	    w_[i] = w_[15-i] = T(w[i]);
+	}
+    };
+
+    const T* nodes() const { return x_; };
+    const T* weights() const { return w_; };
+
+  private:
+
+    T x_[16];
+    T w_[16];
+
+};
+
+// Kahan compensated sum. V may be real or complex; the compensation is
+// then carried for both parts. Requires a compiler that does not
+// reassociate floating point additions (no -ffast-math).
+template<typename V>
+class CompensatedSum {
+
+  public:
+
+    CompensatedSum() : sum_(0), compensation_(0) {};
+
+    void add( const V& x ) 
+    {
+	V y = x - compensation_;
+	V t = sum_ + y;
+	compensation_ = (t - sum_) - y;
+	sum_ = t;
+    };
+    V sum() const { return sum_; };
+
+  protected:
+
+    V sum_;
+    V compensation_;
+
+};
+
+// Integration engine shared by the real and complex integrators. V is
+// the value type of the integrand (T or std::complex<T>) and F the
+// functor type providing evaluate( const T*, V*, int ).
+template<typename T, typename V, int Order>
+class GaussLegendreQuadrature {
+
+  public:
+
+    GaussLegendreQuadrature( int panels, T eps, int maxPanels ) 
+	: panels_(panels), eps_(eps), maxPanels_(maxPanels), adaptive_(false),
+	  errorEstimate_(true), a_(0), b_(0), fixedPanels_(panels) {};
+
+    void panels( int panels ) 
+    { 
+	panels_ = panels; 
+	fixedPanels_ = panels; 
+	fixedNodes_.clear(); 
+    };
+    int panels() { return panels_; };
+    void adaptive( bool adaptive ) { adaptive_ = adaptive; };
+    bool adaptive() { return adaptive_; };
+    // If false, the fixed mode evaluates only the composite rule it
+    // returns, on twice the current number of panels, and no longer
+    // checks the tolerance or doubles the panels. This saves a third
+    // of the integrand evaluations. On by default.
+    void errorEstimate( bool errorEstimate ) { errorEstimate_ = errorEstimate; };
+    bool errorEstimate() { return errorEstimate_; };
+
+    template<class F>
+    V integrate( F& func, T a, T b, bool& ier ) 
+    {
+	ier = false;
+	return adaptive_ ? integrateAdaptive(func, a, b, ier) : integrateFixed(func, a, b, ier);
+    };
+
+  protected:
+
+    struct Panel { T a; T b; V left; V right; V estimate; T error; };
+
+    struct PanelLess 
+    {
+	bool operator()( const Panel& p, const Panel& q ) const { return p.error < q.error; };
+    };
+
+    // Order-point estimate over [a,b]
+    template<class F>
+    V panel( F& func, T a, T b ) 
+    {
+	T c = (T)0.5 * (a + b);
+	T h = (T)0.5 * (b - a);
+	const T* x = rule_.nodes();
+	for ( int i = 0; i < Order; i++ ) 
+	{
+	    x_[i] = c + h * x[i];
+	}
+	func.evaluate(x_, y_, Order);
+	const T* w = rule_.weights();
+	V sum = 0;
+	for ( int i = 0; i < Order; i++ ) 
+	{
+	    sum += w[i] * y_[i];
+	}
+	return h * sum;
+    };
+
+    // The fixed node set holds the nodes of fixedPanels_ equal panels
+    // followed by those of their halves, and all of them are evaluated
+    // in one call. The difference between the two composite estimates
+    // is the error estimate, with the same tolerance as the adaptive
+    // mode. While it is not met the number of panels is doubled, up to
+    // maxPanels_; the halves then become the panels, so only the new
+    // halves are evaluated. The number is kept for the following calls,
+    // so once it suits the most oscillatory integrand the nodes no
+    // longer change. They are recomputed when the interval changes.
+    template<class F>
+    V integrateFixed( F& func, T a, T b, bool& ier ) 
+    {
+	if ( a != a_ || b != b_ ) 
+	{
+	    a_ = a;
+	    b_ = b;
+	    fixedPanels_ = panels_;
+	    fixedNodes_.clear();
+	}
+	int n = fixedPanels_ * Order;
+	if ( int(fixedNodes_.size()) != 3 * n ) 
+	{
+	    fixedNodes_.resize(3 * n);
+	    fixedWeights_.resize(3 * n);
+	    fixedValues_.resize(3 * n);
+	    fixedRule(a, b, fixedPanels_, 0);
+	    fixedRule(a, b, 2 * fixedPanels_, n);
+	}
+	if ( !errorEstimate_ ) 
+	{
+	    func.evaluate(&fixedNodes_[n], &fixedValues_[n], 2 * n);
+	    return fixedSum(n, 3 * n);
+	}
+	func.evaluate(&fixedNodes_[0], &fixedValues_[0], 3 * n);
+	for ( ;; ) 
+	{
+	    V estimate = fixedSum(n, 3 * n);
+	    T error = std::abs(estimate - fixedSum(0, n));
+	    if ( error <= std::max(eps_, eps_ * std::abs(estimate)) ) 
+	    {
+		return estimate;
+	    }
+	    if ( 2 * fixedPanels_ > maxPanels_ ) 
+	    {
+		ier = true;
+		return estimate;
+	    }
+	    fixedNodes_.erase(fixedNodes_.begin(), fixedNodes_.begin() + n);
+	    fixedWeights_.erase(fixedWeights_.begin(), fixedWeights_.begin() + n);
+	    fixedValues_.erase(fixedValues_.begin(), fixedValues_.begin() + n);
+	    fixedPanels_ *= 2;
+	    n *= 2;
+	    fixedNodes_.resize(3 * n);
+	    fixedWeights_.resize(3 * n);
+	    fixedValues_.resize(3 * n);
+	    fixedRule(a, b, 2 * fixedPanels_, n);
+	    func.evaluate(&fixedNodes_[n], &fixedValues_[n], 2 * n);
+	}
+    };
+
+    // Compensated sum of the weighted fixed values in [first,last)
+    V fixedSum( int first, int last ) 
+    {
+	CompensatedSum<V> sum;
+	for ( int i = first; i < last; i++ ) 
+	{
+	    sum.add(fixedWeights_[i] * fixedValues_[i]);
+	}
+	return sum.sum();
+    };
+
+    // Nodes and weights of the composite rule with the given number of
+    // panels, stored from offset on
+    void fixedRule( T a, T b, int panels, int offset ) 
+    {
+	T h = (T)0.5 * (b - a) / panels;
+	for ( int p = 0; p < panels; p++ ) 
+	{
+	    T c = a + (2 * p + 1) * h;
+	    for ( int i = 0; i < Order; i++ ) 
+	    {
+		fixedNodes_[offset+p*Order+i] = c + h * rule_.nodes()[i];
+		fixedWeights_[offset+p*Order+i] = h * rule_.weights()[i];
+	    }
+	}
+    };
+
+    // Same strategy as dqag: the panel with the largest error estimate
+    // is bisected until the summed error estimate is below
+    // max(eps, eps*|integral|). A panel's estimate is the sum of the
+    // Order-point rule on its two halves and its error the difference
+    // to the Order-point rule on the whole panel.
+    template<class F>
+    V integrateAdaptive( F& func, T a, T b, bool& ier ) 
+    {
+	heap_.clear();
+	T h = (b - a) / panels_;
+	for ( int p = 0; p < panels_; p++ ) 
+	{
+	    T pa = a + p * h;
+	    T pb = p == panels_ - 1 ? b : pa + h;
+	    heap_.push_back(refine(func, pa, pb, panel(func, pa, pb)));
+	}
+	std::make_heap(heap_.begin(), heap_.end(), PanelLess());
+	// The running sum is updated by differences on every bisection,
+	// so it is compensated to avoid accumulating rounding errors.
+	CompensatedSum<V> sum;
+	T error = 0;
+	for ( size_t i = 0; i < heap_.size(); i++ ) 
+	{
+	    sum.add(heap_[i].estimate);
+	    error += heap_[i].error;
+	}
+	while ( error > std::max(eps_, eps_ * std::abs(sum.sum())) ) 
+	{
+	    if ( int(heap_.size()) >= maxPanels_ ) 
+	    {
+		ier = true;
+		break;
+	    }
+	    std::pop_heap(heap_.begin(), heap_.end(), PanelLess());
+	    Panel p = heap_.back();
+	    heap_.pop_back();
+	    T c = (T)0.5 * (p.a + p.b);
+	    if ( !(p.a < c && c < p.b) ) 
+	    {
+		ier = true;
+		break;
+	    }
+	    Panel l = refine(func, p.a, c, p.left);
+	    Panel r = refine(func, c, p.b, p.right);
+	    sum.add(l.estimate);
+	    sum.add(r.estimate);
+	    sum.add(-p.estimate);
+	    error += l.error + r.error - p.error;
+	    heap_.push_back(l);
+	    std::push_heap(heap_.begin(), heap_.end(), PanelLess());
+	    heap_.push_back(r);
+	    std::push_heap(heap_.begin(), heap_.end(), PanelLess());
+	}
+	return sum.sum();
+    };
+
+    // Evaluates the two halves of [a,b] given the whole-panel estimate
+    template<class F>
+    Panel refine( F& func, T a, T b, V whole ) 
+    {
+	T c = (T)0.5 * (a + b);
+	Panel p;
+	p.a = a;
+	p.b = b;
+	p.left = panel(func, a, c);
+	p.right = panel(func, c, b);
+	p.estimate = p.left + p.right;
+	p.error = std::abs(p.estimate - whole);
+	return p;
+    };
+
+  protected:
+
+    GaussLegendreRule<T, Order> rule_;
+    int panels_;
+    T eps_;
+    int maxPanels_;
+    bool adaptive_;
+    bool errorEstimate_;
+    T x_[Order];
+    V y_[Order];
+    T a_;
+    T b_;
+    int fixedPanels_;
+    std::vector<T> fixedNodes_;
+    std::vector<T> fixedWeights_;
+    std::vector<V> fixedValues_;
+    std::vector<Panel> heap_;
+
+};
+
+template<typename T, int Order = 16>
+class GaussLegendreIntegrator : public Integrator<T> {
+
+  public:
+
+    GaussLegendreIntegrator( Functor<T>* func, T a, T b, T eps, int panels = 8, int maxPanels = 2000 )
+	: Integrator<T>(func, a, b), quadrature_(panels, eps, maxPanels) {};
+    virtual ~GaussLegendreIntegrator() {};
+
+    // Returns integration value of a functor over interval [a,b]
+    virtual T operator()() 
+    {
+	return quadrature_.integrate(*this->func_, this->a_, this->b_, this->ier_);
+    };
+
+    void panels( int panels ) { quadrature_.panels(panels); };
+    void adaptive( bool adaptive ) { quadrature_.adaptive(adaptive); };
+    void errorEstimate( bool errorEstimate ) { quadrature_.errorEstimate(errorEstimate); };
+
+  protected:
+
+    // not allowed
+    GaussLegendreIntegrator(GaussLegendreIntegrator<T, Order>&);
+    GaussLegendreIntegrator& operator=(GaussLegendreIntegrator<T, Order>&);
+
+  protected:
+
+    GaussLegendreQuadrature<T, T, Order> quadrature_;
+
+};
+
+template<typename T, int Order = 16>
+class GaussLegendreComplexIntegrator : public IntegratorComplex<T> {
+
+  public:
+
+    GaussLegendreComplexIntegrator( FunctorComplex<T>* func, T a, T b, T eps, int panels = 8, int maxPanels = 2000 )
+	: IntegratorComplex<T>(func, a, b), quadrature_(panels, eps, maxPanels) {};
+    virtual ~GaussLegendreComplexIntegrator() {};
+
+    // Returns integration value of a complex functor over interval [a,b]
+    virtual std::complex<T> operator()() 
+    {
+	return quadrature_.integrate(*this->func_, this->a_, this->b_, this->ier_);
+    };
+
+    void panels( int panels ) { quadrature_.panels(panels); };
+    void adaptive( bool adaptive ) { quadrature_.adaptive(adaptive); };
+    void errorEstimate( bool errorEstimate ) { quadrature_.errorEstimate(errorEstimate); };
+
+  protected:
+
+    // not allowed
+    GaussLegendreComplexIntegrator(GaussLegendreComplexIntegrator<T, Order>&);
+    GaussLegendreComplexIntegrator& operator=(GaussLegendreComplexIntegrator<T, Order>&);
+
+  protected:
+
+    GaussLegendreQuadrature<T, std::complex<T>, Order> quadrature_;
+
+};
+
+}
+
+#endif // _GAUSS_LEGENDRE_INTEGRATOR_H
@@ -0,0 +1,59 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+#ifndef _GIBSON_LANI_COMPLEX_FUNCTOR_H
+#define _GIBSON_LANI_COMPLEX_FUNCTOR_H
+
+#include "functorComplex.h"
+#include "gibsonLaniFunctor.h"
+
+namespace cosm {
+
+// Presents the cos and sin integrands of a GibsonLaniFunctor as one
+// complex integrand so that both are integrated at shared nodes.
+template<typename T>
+class GibsonLaniComplexFunctor : public FunctorComplex<T> {
+
+  public:
+
+    GibsonLaniComplexFunctor( GibsonLaniFunctor<T>& gibsonLani ) 
+	: FunctorComplex<T>(), gibsonLani_(gibsonLani) {};
+    ~GibsonLaniComplexFunctor() {};
+
+    virtual std::complex<T> operator()( T x ) { return gibsonLani_.integrand(x); };
+
+    virtual void evaluate( const T* x, std::complex<T>* y, int n ) 
+    { 
+	gibsonLani_.integrand(x, y, n); 
+    };
+
+  protected:
+
+    // not allowed
+    GibsonLaniComplexFunctor( GibsonLaniComplexFunctor<T>& );
+    GibsonLaniComplexFunctor& operator=( GibsonLaniComplexFunctor<T>& );
+
+  protected:
+
+    GibsonLaniFunctor<T>& gibsonLani_;
+
+};
+
+}
+
+#endif // _GIBSON_LANI_COMPLEX_FUNCTOR_H
@@ -27,7 +27,11 @@
 #include "opdBase.h"
 #include "bessel0nr.h"
 #include "expFunctor.h"
+#include "sinCos.h"
 #include <cmath>
+#include <complex>
+#include <cstring>
+#include <vector>
 
 namespace cosm {
 
@@ -37,7 +41,8 @@ class GibsonLaniFunctor : public Functor<T> {
   public:
 
     GibsonLaniFunctor(T lambda, opdBase<T>& opd_in) 
-    : exp_(&cos_), opd_(opd_in), k_(M_PI*2.0/lambda), r_(0), pre_(0) {};
+    : exp_(&cos_), opd_(opd_in), k_(M_PI*2.0/lambda), r_(0), pre_(0),
+      cacheNodes_(false), phasesValid_(false), z_(0) {};
     ~GibsonLaniFunctor() {};
 
     virtual T operator()( T x ) 
@@ -46,15 +51,130 @@ class GibsonLaniFunctor : public Functor<T> {
 	return amplitude == 0 ? 0 :
 		j0_(pre_* sqrt(x))*(*exp_)(k_*opd_(x))*opd_.amplitude(x);
     };
+
+    // Returns the integrand with the cos part as the real part and the
+    // sin part as the imaginary part.
+    std::complex<T> integrand( T x ) 
+    { 
+	T amplitude = opd_.amplitude(x);
+	if ( amplitude == 0 ) 
+	{
+	    return 0;
+	}
+	T value = j0_(pre_* sqrt(x))*amplitude;
+	T phase = k_*opd_(x);
+	return std::complex<T>(value*cos(phase), value*sin(phase));
+    };
+
+    // Same as integrand( T x ) at n points. The OPD, the amplitude and
+    // J0 are evaluated for all points first so that the main loop has
+    // no calls.
+    void integrand( const T* x, std::complex<T>* y, int n )
+    {
+	if ( !cacheNodes_ || n == 0 || int(nodes_.size()) != n || 
+	     memcmp(&nodes_[0], x, n*sizeof(T)) != 0 ) 
+	{
+	    nodes_.assign(x, x + n);
+	    amplitudes_.resize(n);
+	    sqrtNodes_.resize(n);
+	    opd_.amplitude(x, &amplitudes_[0], n);
+	    for ( int i = 0; i < n; i++ )
+	    {
+		sqrtNodes_[i] = sqrt(x[i]);
+	    }
+	    phasesValid_ = false;
+	}
+	if ( !phasesValid_ ) 
+	{
+	    phaseTerms(x, n);
+	    phasesValid_ = cacheNodes_;
+	}
+	j0Values_.resize(n);
+	for ( int i = 0; i < n; i++ )
+	{
+	    j0Values_[i] = pre_* sqrtNodes_[i];
+	}
+	j0_.evaluate(&j0Values_[0], &j0Values_[0], n);
+	// Local pointers keep the loop vectorizable
+	const T* j0 = &j0Values_[0];
+	const T* re = &phasesRe_[0];
+	const T* im = &phasesIm_[0];
+	for ( int i = 0; i < n; i++ )
+	{
+	    y[i] = std::complex<T>(j0[i]*re[i], j0[i]*im[i]);
+	}
+    };
+
+    // If true, the amplitude and the z-independent part of the OPD are
+    // kept for the last set of nodes passed to the batch integrand and
+    // reused while the nodes do not change, and the amplitude times the
+    // phase at the nodes is kept until z changes, so evaluating many
+    // radii at the same z costs only J0. Only useful with integrators
+    // that use a fixed set of nodes.
+    void cacheNodes( bool cacheNodes ) 
+    { 
+	cacheNodes_ = cacheNodes; 
+	nodes_.clear();
+	opd_.cacheNodes(cacheNodes);
+    };
+
     void setCos() { exp_ = &cos_; };
     void setSin() { exp_ = &sin_; };
     void setR( T r ) { r_ = r; pre_ = k_ * r_; };
-    void setZ( T z ) { opd_.setZ(z); };
+    // Changes the depth of the point source in the specimen layer.
+    // The OPD is linear in it, so the node terms are kept; only the
+    // phase is recomputed.
+    void setDepth( T ts ) 
+    { 
+	opd_.setTs(ts); 
+	phasesValid_ = false; 
+    };
+    // Changes the emission wavelength. The terms that only depend on
+    // the nodes are kept; only the phase is recomputed.
+    void setWavelength( T lambda ) 
+    { 
+	k_ = T(M_PI*2.0/lambda); 
+	pre_ = k_ * r_; 
+	phasesValid_ = false; 
+    };
+    void setZ( T z ) 
+    { 
+	phasesValid_ = phasesValid_ && z == z_; 
+	z_ = z; 
+	opd_.setZ(z); 
+    };
     T getK() { return k_; };
     T getR() { return r_; };
     T getPre() { return pre_; };
     T opd( T x ) { return opd_(x); };
   
+  protected:
+
+    // Computes the amplitude times the phase of the batch integrand at
+    // the current z. It is zero outside the aperture, where the OPD may
+    // not be finite.
+    void phaseTerms( const T* x, int n ) 
+    {
+	opdValues_.resize(n);
+	phasesRe_.resize(n);
+	phasesIm_.resize(n);
+	opd_.evaluate(x, &opdValues_[0], n);
+	const T* a = &amplitudes_[0];
+	const T* opd = &opdValues_[0];
+	T* re = &phasesRe_[0];
+	T* im = &phasesIm_[0];
+	T k = k_;
+	for ( int i = 0; i < n; i++ )
+	{
+	    bool outside = a[i] == 0;
+	    T s;
+	    T c;
+	    sinCos(outside ? T(0) : k*opd[i], s, c);
+	    re[i] = outside ? T(0) : a[i]*c;
+	    im[i] = outside ? T(0) : a[i]*s;
+	}
+    };
+
   protected:
 
     // not allowed
@@ -71,6 +191,16 @@ class GibsonLaniFunctor : public Functor<T> {
     T k_;
     T r_;
     T pre_; 
+    bool cacheNodes_;
+    bool phasesValid_;
+    T z_;
+    std::vector<T> nodes_;
+    std::vector<T> amplitudes_;
+    std::vector<T> sqrtNodes_;
+    std::vector<T> opdValues_;
+    std::vector<T> phasesRe_;
+    std::vector<T> phasesIm_;
+    std::vector<T> j0Values_;
 
 };
 
@@ -23,8 +23,11 @@
 #include "psf/psfFunctor.h"
 #include "psf/dqagIntegrator.h"
 //#include "psf/qsimpIntegrator.h"
+#include "psf/gaussLegendreIntegrator.h"
 #include "psf/gibsonLaniFunctor.h"
+#include "psf/gibsonLaniComplexFunctor.h"
 #include "psf/opdXcosm.h"
+#include <algorithm>
 #include <complex>
 
 namespace cosm {
@@ -54,7 +57,16 @@ class GibsonLaniPsfFunctor : public PsfFunctor<T> {
     ) : PsfFunctor<T>(), 
 	opd_(ts, tid, tia, tgd, tga, ns, nid, nia, ngd, nga, tld, tla, lm, na),
         gibsonLaniFunctor_(lambda, opd_),
-        integrator_(&gibsonLaniFunctor_, 0, na*na, absError)
+        integrator_(&gibsonLaniFunctor_, 0, na*na, absError),
+        complexFunctor_(gibsonLaniFunctor_),
+        gaussLegendreIntegrator_(&complexFunctor_, 0, 
+            std::min(na*na, opd_.apertureLimit()), absError),
+        integration_(PsfFunctor<T>::INTEGRATION_DQAG),
+        ts_(ts), tid_(tid), tia_(tia), tgd_(tgd), tga_(tga),
+        ns_(ns), nid_(nid), nia_(nia), ngd_(ngd), nga_(nga),
+        tld_(tld), tla_(tla), lm_(lm), na_(na), lambda_(lambda),
+        absError_(absError),
+        errorEstimate_(true)
     {};
 
     ~GibsonLaniPsfFunctor() {};
@@ -63,6 +75,10 @@ class GibsonLaniPsfFunctor : public PsfFunctor<T> {
     {
         gibsonLaniFunctor_.setZ(z);
         gibsonLaniFunctor_.setR(r);
+        if ( integration_ != PsfFunctor<T>::INTEGRATION_DQAG ) 
+        {
+            return gaussLegendreIntegrator_();
+        }
 		gibsonLaniFunctor_.setCos();
         T realPart = integrator_();
         gibsonLaniFunctor_.setSin();
@@ -75,6 +91,51 @@ class GibsonLaniPsfFunctor : public PsfFunctor<T> {
     };
    
     virtual bool isSymmetric() { return opd_.isSymmetric(); };
+
+    virtual void wavelength( T lambda ) 
+    { 
+        gibsonLaniFunctor_.setWavelength(lambda); 
+        lambda_ = lambda; 
+    };
+
+    virtual bool depth( T ts ) 
+    { 
+        gibsonLaniFunctor_.setDepth(ts); 
+        ts_ = ts; 
+        return true; 
+    };
+
+    virtual PsfFunctor<T>* clone() 
+    {
+	GibsonLaniPsfFunctor<T>* psf = new GibsonLaniPsfFunctor<T>(
+	    ts_, tid_, tia_, tgd_, tga_,
+	    ns_, nid_, nia_, ngd_, nga_,
+	    tld_, tla_,
+	    lm_, na_, lambda_, absError_
+	);
+	psf->integration(integration_);
+	psf->errorEstimate(errorEstimate_);
+	return psf;
+    };
+
+    virtual void integration( typename PsfFunctor<T>::Integration integration ) 
+    { 
+        integration_ = integration; 
+        gaussLegendreIntegrator_.adaptive(
+            integration == PsfFunctor<T>::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE);
+        // the fixed mode settles on one set of nodes
+        gibsonLaniFunctor_.cacheNodes(
+            integration == PsfFunctor<T>::INTEGRATION_GAUSS_LEGENDRE);
+    };
+
+    // If false, the fixed Gauss-Legendre integration keeps its current
+    // number of panels without checking the tolerance, see
+    // GaussLegendreQuadrature::errorEstimate(). On by default.
+    void errorEstimate( bool errorEstimate ) 
+    { 
+        errorEstimate_ = errorEstimate; 
+        gaussLegendreIntegrator_.errorEstimate(errorEstimate); 
+    };
   
   protected:
 
@@ -88,6 +149,27 @@ class GibsonLaniPsfFunctor : public PsfFunctor<T> {
     GibsonLaniFunctor<T> gibsonLaniFunctor_;
     DqagIntegrator<T> integrator_;
     //QSimpIntegrator<T> integrator_;
+    GibsonLaniComplexFunctor<T> complexFunctor_;
+    GaussLegendreComplexIntegrator<T> gaussLegendreIntegrator_;
+    typename PsfFunctor<T>::Integration integration_;
+    // the current optical parameters, kept for clone()
+    T ts_;
+    T tid_;
+    T tia_;
+    T tgd_;
+    T tga_;
+    T ns_;
+    T nid_;
+    T nia_;
+    T ngd_;
+    T nga_;
+    T tld_;
+    T tla_;
+    T lm_;
+    T na_;
+    T lambda_;
+    T absError_;
+    bool errorEstimate_;
 
 };
 
@@ -0,0 +1,59 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+#ifndef _HAEBERLE_COMPLEX_FUNCTOR_H
+#define _HAEBERLE_COMPLEX_FUNCTOR_H
+
+#include "functorComplex.h"
+#include "haeberleFunctor.h"
+
+namespace cosm {
+
+// Presents the combined complex integrand of a HaeberleFunctor so
+// that a single complex integration replaces the six real ones.
+template<typename T>
+class HaeberleComplexFunctor : public FunctorComplex<T> {
+
+  public:
+
+    HaeberleComplexFunctor( HaeberleFunctor<T>& haeberle ) 
+	: FunctorComplex<T>(), haeberle_(haeberle) {};
+    ~HaeberleComplexFunctor() {};
+
+    virtual std::complex<T> operator()( T x ) { return haeberle_.integrand(x); };
+
+    virtual void evaluate( const T* x, std::complex<T>* y, int n ) 
+    { 
+	haeberle_.integrand(x, y, n); 
+    };
+
+  protected:
+
+    // not allowed
+    HaeberleComplexFunctor( HaeberleComplexFunctor<T>& );
+    HaeberleComplexFunctor& operator=( HaeberleComplexFunctor<T>& );
+
+  protected:
+
+    HaeberleFunctor<T>& haeberle_;
+
+};
+
+}
+
+#endif // _HAEBERLE_COMPLEX_FUNCTOR_H
@@ -18,16 +18,21 @@
  ****************************************************************************/
 
 #ifndef _HAEBERLE_FUNCTOR_H
-#define _HEABERLE_FUNCTOR_H
+#define _HAEBERLE_FUNCTOR_H
 
 #ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
 #endif
 
 #include "opdBase.h"
+#include "bessel012nr.h"
+#include "sinCos.h"
 #include "besselnm.h"
 #include "expFunctor.h"
 #include <cmath>
+#include <complex>
+#include <cstring>
+#include <vector>
 
 namespace cosm {
 
@@ -49,7 +54,7 @@ class HaeberleFunctor : public Functor<T> {
       ns_(opd_.ns()), nia_(opd_.nia()), nga_(opd_.nga()), 
       ns2_(ns_*2), nia2_(nia_*2), nga2_(nga_*2),
       niasq_(nia_*nia_), niaons_(nia_/ns_), niaonga_(nia_/nga_), 
-      type_(HAEBERLE_I0)
+      type_(HAEBERLE_I0), cacheNodes_(false), phasesValid_(false), z_(0)
     { };
     ~HaeberleFunctor() {};
 
@@ -123,16 +128,189 @@ class HaeberleFunctor : public Functor<T> {
 	return retVal;
     };
 
+    // Returns the integrand of I0 + 2*I1 + I2 with the cos part as the
+    // real part and the sin part as the imaginary part. The angles, the
+    // Fresnel coefficients, the OPD and the phase are computed once for
+    // all three terms.
+    std::complex<T> integrand( T x )
+    {
+	T amplitude = opd_.amplitude(x);
+	if ( amplitude == 0 )   
+ 	{
+	    return 0;
+	}
+        T ctheta1 = sqrt(1 - x/niasq_);
+        T stheta1 = sqrt(1 - ctheta1*ctheta1);
+        T stheta2 = stheta1 * niaonga_;
+        T ctheta2 = sqrt(1 - stheta2*stheta2);
+        T stheta3 = stheta1 * niaons_;
+        T ctheta3 = sqrt(1 - stheta3*stheta3);
+
+        T ts = nia2_*ctheta1/(nia_*ctheta1+nga_*ctheta2) *  
+	       nga2_*ctheta2/(nga_*ctheta2+ns_*ctheta3);
+        T tp = nia2_ *ctheta1/(nga_*ctheta1+nia_*ctheta2) *
+	       nga2_*ctheta2/(ns_*ctheta2+nga_*ctheta3);
+
+	T u = pre_ * sqrt(x);
+	T sum = (ts + tp*ctheta3) * T(j0(u))
+	      + 2 * tp*stheta3 * T(j1(u))
+	      + (ts - tp*ctheta3) * T(jn(2, u));
+	sum *= amplitude*sqrt(ctheta1);
+
+	T phase = k_*opd_(x);
+	return std::complex<T>(sum*cos(phase), sum*sin(phase));
+    };
+
+    // Same as integrand( T x ) at n points. The OPD, the amplitude and
+    // the Bessel functions are evaluated for all points first so that
+    // the main loop has no calls. The Bessel functions come from the
+    // J012nr fits (absolute error below 1e-8) rather than libm.
+    void integrand( const T* x, std::complex<T>* y, int n )
+    {
+	if ( !cacheNodes_ || !sameNodes(x, n) ) 
+	{
+	    nodeTerms(x, n);
+	    phasesValid_ = false;
+	}
+	if ( !phasesValid_ ) 
+	{
+	    phaseTerms(x, n);
+	    phasesValid_ = cacheNodes_;
+	}
+	besselArguments_.resize(n);
+	j0Values_.resize(n);
+	j1Values_.resize(n);
+	j2Values_.resize(n);
+	for ( int i = 0; i < n; i++ )
+	{
+	    besselArguments_[i] = pre_ * sqrtNodes_[i];
+	}
+	bessel_(&besselArguments_[0], &j0Values_[0], &j1Values_[0], &j2Values_[0], n);
+	// The arrays are read through local pointers so that the loop
+	// vectorizes.
+	const T* w0 = &weights0_[0];
+	const T* w1 = &weights1_[0];
+	const T* w2 = &weights2_[0];
+	const T* j0 = &j0Values_[0];
+	const T* j1 = &j1Values_[0];
+	const T* j2 = &j2Values_[0];
+	const T* c = &cosPhases_[0];
+	const T* s = &sinPhases_[0];
+	for ( int i = 0; i < n; i++ )
+	{
+	    T sum = w0[i] * j0[i] + w1[i] * j1[i] + w2[i] * j2[i];
+	    y[i] = std::complex<T>(sum*c[i], sum*s[i]);
+	}
+    };
+
+    // If true, the terms of the batch integrand that depend on the node
+    // only (the Fresnel coefficients, the amplitude and the
+    // z-independent part of the OPD) are kept for the last set of nodes
+    // and reused while the nodes do not change, and the phase at the
+    // nodes is kept until z changes, so evaluating many radii at the
+    // same z costs only the Bessel functions. Only useful with
+    // integrators that use a fixed set of nodes.
+    void cacheNodes( bool cacheNodes ) 
+    { 
+	cacheNodes_ = cacheNodes; 
+	nodes_.clear();
+	opd_.cacheNodes(cacheNodes);
+    };
+
     void setType( Type type ) { type_ = type; };
     void setCos() { exp_ = &cos_; };
     void setSin() { exp_ = &sin_; };
     void setR( T r ) { r_ = r; pre_ = k_ * r_; };
-    void setZ( T z ) { opd_.setZ(z); };
+    // Changes the depth of the point source in the specimen layer.
+    // The OPD is linear in it, so the node terms are kept; only the
+    // phase is recomputed.
+    void setDepth( T ts ) 
+    { 
+	opd_.setTs(ts); 
+	phasesValid_ = false; 
+    };
+    // Changes the emission wavelength. The terms that only depend on
+    // the nodes are kept; only the phase is recomputed.
+    void setWavelength( T lambda ) 
+    { 
+	k_ = T(M_PI*2.0/lambda); 
+	pre_ = k_ * r_; 
+	phasesValid_ = false; 
+    };
+    void setZ( T z ) 
+    { 
+	phasesValid_ = phasesValid_ && z == z_; 
+	z_ = z; 
+	opd_.setZ(z); 
+    };
     T getK() { return k_; };
     T getR() { return r_; };
     T getPre() { return pre_; };
     T opd( T x ) { return opd_(x); };
   
+  protected:
+
+    bool sameNodes( const T* x, int n ) 
+    {
+	return n > 0 && int(nodes_.size()) == n && 
+	    memcmp(&nodes_[0], x, n*sizeof(T)) == 0;
+    };
+
+    // Computes the terms of the batch integrand that do not depend on
+    // z or r.
+    void nodeTerms( const T* x, int n ) 
+    {
+	nodes_.assign(x, x + n);
+	amplitudes_.resize(n);
+	sqrtNodes_.resize(n);
+	weights0_.resize(n);
+	weights1_.resize(n);
+	weights2_.resize(n);
+	opd_.amplitude(x, &amplitudes_[0], n);
+	for ( int i = 0; i < n; i++ )
+	{
+	    T ctheta1 = sqrt(1 - x[i]/niasq_);
+	    T stheta1 = sqrt(1 - ctheta1*ctheta1);
+	    T stheta2 = stheta1 * niaonga_;
+	    T ctheta2 = sqrt(1 - stheta2*stheta2);
+	    T stheta3 = stheta1 * niaons_;
+	    T ctheta3 = sqrt(1 - stheta3*stheta3);
+
+	    T ts = nia2_*ctheta1/(nia_*ctheta1+nga_*ctheta2) *  
+		   nga2_*ctheta2/(nga_*ctheta2+ns_*ctheta3);
+	    T tp = nia2_ *ctheta1/(nga_*ctheta1+nia_*ctheta2) *
+		   nga2_*ctheta2/(ns_*ctheta2+nga_*ctheta3);
+
+	    T scale = amplitudes_[i] == 0 ? T(0) : amplitudes_[i]*sqrt(ctheta1);
+	    sqrtNodes_[i] = sqrt(x[i]);
+	    weights0_[i] = scale * (ts + tp*ctheta3);
+	    weights1_[i] = scale * 2 * tp*stheta3;
+	    weights2_[i] = scale * (ts - tp*ctheta3);
+	}
+    };
+
+    // Computes the phase of the batch integrand at the current z. It
+    // is zero outside the aperture, where the OPD may not be finite.
+    void phaseTerms( const T* x, int n ) 
+    {
+	opdValues_.resize(n);
+	cosPhases_.resize(n);
+	sinPhases_.resize(n);
+	opd_.evaluate(x, &opdValues_[0], n);
+	const T* a = &amplitudes_[0];
+	const T* opd = &opdValues_[0];
+	T* c = &cosPhases_[0];
+	T* s = &sinPhases_[0];
+	T k = k_;
+	for ( int i = 0; i < n; i++ )
+	{
+	    bool outside = a[i] == 0;
+	    sinCos(outside ? T(0) : k*opd[i], s[i], c[i]);
+	    c[i] = outside ? T(0) : c[i];
+	    s[i] = outside ? T(0) : s[i];
+	}
+    };
+
   protected:
 
     // not allowed
@@ -159,6 +337,23 @@ class HaeberleFunctor : public Functor<T> {
     T niaons_;
     T niaonga_;
     Type type_;
+    J012nr<T> bessel_;
+    bool cacheNodes_;
+    bool phasesValid_;
+    T z_;
+    std::vector<T> nodes_;
+    std::vector<T> amplitudes_;
+    std::vector<T> sqrtNodes_;
+    std::vector<T> weights0_;
+    std::vector<T> weights1_;
+    std::vector<T> weights2_;
+    std::vector<T> opdValues_;
+    std::vector<T> cosPhases_;
+    std::vector<T> sinPhases_;
+    std::vector<T> besselArguments_;
+    std::vector<T> j0Values_;
+    std::vector<T> j1Values_;
+    std::vector<T> j2Values_;
 
 };
 
@@ -22,8 +22,12 @@
 
 #include "psf/psfFunctor.h"
 #include "psf/dqagIntegrator.h"
+#include "psf/dqagComplexIntegrator.h"
+#include "psf/gaussLegendreIntegrator.h"
 #include "psf/haeberleFunctor.h"
+#include "psf/haeberleComplexFunctor.h"
 #include "psf/opdXcosm.h"
+#include <algorithm>
 #include <complex>
 
 namespace cosm {
@@ -53,13 +57,37 @@ class HaeberlePsfFunctor : public PsfFunctor<T> {
     ) : PsfFunctor<T>(), 
 	opd_(ts, tid, tia, tgd, tga, ns, nid, nia, ngd, nga, tld, tla, lm, na),
         haeberleFunctor_(lambda, opd_),
-        integrator_(&haeberleFunctor_, 0, na*na, absError)
+        integrator_(&haeberleFunctor_, 0, na*na, absError),
+        complexFunctor_(haeberleFunctor_),
+        complexIntegrator_(&complexFunctor_, 0, na*na, absError),
+        gaussLegendreIntegrator_(&complexFunctor_, 0, 
+            std::min(na*na, opd_.apertureLimit()), absError),
+        integration_(PsfFunctor<T>::INTEGRATION_DQAG),
+        ts_(ts), tid_(tid), tia_(tia), tgd_(tgd), tga_(tga),
+        ns_(ns), nid_(nid), nia_(nia), ngd_(ngd), nga_(nga),
+        tld_(tld), tla_(tla), lm_(lm), na_(na), lambda_(lambda),
+        absError_(absError),
+        singlePass_(true),
+        errorEstimate_(true)
     {};
 
     ~HaeberlePsfFunctor() {};
 
     virtual complex<T> operator()( T z, T r ) 
     {
+        if ( integration_ != PsfFunctor<T>::INTEGRATION_DQAG ) 
+        {
+            haeberleFunctor_.setZ(z);
+            haeberleFunctor_.setR(r);
+            return gaussLegendreIntegrator_();
+        }
+        if ( singlePass_ ) 
+        {
+            haeberleFunctor_.setZ(z);
+            haeberleFunctor_.setR(r);
+            return complexIntegrator_();
+        }
+
         complex<T> retVal = 0;
 		T realPart = 0;
         T imagPart = 0;
@@ -92,6 +120,60 @@ class HaeberlePsfFunctor : public PsfFunctor<T> {
     };
    
     virtual bool isSymmetric() { return opd_.isSymmetric(); };
+
+    virtual void wavelength( T lambda ) 
+    { 
+        haeberleFunctor_.setWavelength(lambda); 
+        lambda_ = lambda; 
+    };
+
+    virtual bool depth( T ts ) 
+    { 
+        haeberleFunctor_.setDepth(ts); 
+        ts_ = ts; 
+        return true; 
+    };
+
+    virtual PsfFunctor<T>* clone() 
+    {
+	HaeberlePsfFunctor<T>* psf = new HaeberlePsfFunctor<T>(
+	    ts_, tid_, tia_, tgd_, tga_,
+	    ns_, nid_, nia_, ngd_, nga_,
+	    tld_, tla_,
+	    lm_, na_, lambda_, absError_
+	);
+	psf->singlePass(singlePass_);
+	psf->integration(integration_);
+	psf->errorEstimate(errorEstimate_);
+	return psf;
+    };
+
+    // If true (the default), I0, I1 and I2 are integrated together as
+    // one complex integral that shares the quadrature nodes. Otherwise
+    // each of the six real integrals is computed separately.
+    void singlePass( bool singlePass ) { singlePass_ = singlePass; };
+    bool singlePass() { return singlePass_; };
+
+    // The Gauss-Legendre integrations always integrate I0, I1 and I2
+    // in a single pass.
+    virtual void integration( typename PsfFunctor<T>::Integration integration ) 
+    { 
+        integration_ = integration; 
+        gaussLegendreIntegrator_.adaptive(
+            integration == PsfFunctor<T>::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE);
+        // the fixed mode settles on one set of nodes
+        haeberleFunctor_.cacheNodes(
+            integration == PsfFunctor<T>::INTEGRATION_GAUSS_LEGENDRE);
+    };
+
+    // If false, the fixed Gauss-Legendre integration keeps its current
+    // number of panels without checking the tolerance, see
+    // GaussLegendreQuadrature::errorEstimate(). On by default.
+    void errorEstimate( bool errorEstimate ) 
+    { 
+        errorEstimate_ = errorEstimate; 
+        gaussLegendreIntegrator_.errorEstimate(errorEstimate); 
+    };
   
   protected:
 
@@ -104,6 +186,29 @@ class HaeberlePsfFunctor : public PsfFunctor<T> {
     opdXcosm<T> opd_;
     HaeberleFunctor<T> haeberleFunctor_;
     DqagIntegrator<T> integrator_;
+    HaeberleComplexFunctor<T> complexFunctor_;
+    DqagComplexIntegrator<T> complexIntegrator_;
+    GaussLegendreComplexIntegrator<T> gaussLegendreIntegrator_;
+    typename PsfFunctor<T>::Integration integration_;
+    // the current optical parameters, kept for clone()
+    T ts_;
+    T tid_;
+    T tia_;
+    T tgd_;
+    T tga_;
+    T ns_;
+    T nid_;
+    T nia_;
+    T ngd_;
+    T nga_;
+    T tld_;
+    T tla_;
+    T lm_;
+    T na_;
+    T lambda_;
+    T absError_;
+    bool singlePass_;
+    bool errorEstimate_;
 
 };
 
@@ -22,6 +22,7 @@
 
 #include "functor.h"
 #include <math.h>
+#include <limits>
 
 namespace cosm {
 
@@ -49,10 +50,10 @@ class opdBase : public Functor<T> {
 	nidsq_(nid_in*nid_in), niasq_(nia_in*nia_in), 
 	ngdsq_(ngd_in*ngd_in), ngasq_(nga_in*nga_in), 
 	z_(0),
-	symmetric_((ngd_in == nga_in) &&
-                   (tgd_in == tga_in) &&
-                   (nid_in == nia_in) &&
-                   (ts_in == 0.0))
+	symmetricDesign_((ngd_in == nga_in) &&
+                         (tgd_in == tga_in) &&
+                         (nid_in == nia_in)),
+	symmetric_(symmetricDesign_ && (ts_in == 0.0))
     {};
 
     // destructor
@@ -63,9 +64,33 @@ class opdBase : public Functor<T> {
 
     virtual T amplitude( T /*rhoNAsq*/ ) { return 1.0; }
 
+    // function to evaluate the amplitude at n points
+    virtual void amplitude( const T* rhoNAsq, T* y, int n ) 
+    {
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    y[i] = amplitude(rhoNAsq[i]);
+	}
+    };
+
+    // keep the parts of the OPD that do not depend on z for the last
+    // set of points passed to evaluate( const T*, T*, int )
+    virtual void cacheNodes( bool /*cacheNodes*/ ) {};
+
+    // largest rhoNAsq with a nonzero amplitude
+    virtual T apertureLimit() { return std::numeric_limits<T>::max(); };
+
     // function to set the z variable
     void setZ(T z) { z_ = z; };
 
+    // function to set the specimen thickness, i.e., the depth of the
+    // point source in the specimen layer
+    virtual void setTs(T ts) 
+    { 
+	ts_ = ts; 
+	symmetric_ = symmetricDesign_ && (ts == 0.0);
+    };
+
     // abberation is symmetric
     bool isSymmetric() { return symmetric_; };
  
@@ -115,6 +140,7 @@ class opdBase : public Functor<T> {
     T ngasq_;   // nga*nga
 
     T z_;	// variable in Z axis
+    bool symmetricDesign_;	// symmetric at zero depth
     bool symmetric_;
 
 };
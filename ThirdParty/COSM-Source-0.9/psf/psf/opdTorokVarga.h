@@ -53,6 +53,12 @@ class opdTorokVarga : public opdBase<T> {
     // destructor
     ~opdTorokVarga() {};
 
+    virtual void setTs(T ts) 
+    { 
+	opdBase<T>::setTs(ts); 
+	nsts_ = this->ns_*ts; 
+    };
+
     // function to evaluate the OPD
     virtual T operator()( T rhoNAsq ) { 
 	return (  
@@ -21,7 +21,9 @@
 #define _OPD_XCOSM_H
 
 #include "opdBase.h"
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace cosm {
 
@@ -51,8 +53,10 @@ class opdXcosm : public opdBase<T> {
 	niaongd_(nia_in/ngd_in), niaonga_(nia_in/nga_in),
 	s4_((this->nssq_-this->niasq_)/this->ns_), 
 	i4_((this->nidsq_-this->niasq_)/this->nid_), 
-	g5_(tga_in*nga_in-tgd_in*ngd_in-this->niasq_*(tga_in/nga_in-tgd_in/ngd_in))
+	g5_(tga_in*nga_in-tgd_in*ngd_in-this->niasq_*(tga_in/nga_in-tgd_in/ngd_in)),
+	cacheNodes_(false)
     {
+	this->symmetricDesign_ = this->symmetricDesign_ && (otd_in == ota_in);
 	this->symmetric_ = this->symmetric_ && (otd_in == ota_in);
     };
 
@@ -92,6 +96,78 @@ class opdXcosm : public opdBase<T> {
 	);
     };
   
+    // Same as operator() at n points, written without calls so that
+    // the loop can be vectorized. When the nodes are cached and have
+    // not changed, the OPD is (z+t1)*slope + ts*depthSlope + base per
+    // point, so neither z nor the depth invalidates the cache.
+    virtual void evaluate( const T* rhoNAsq, T* y, int n ) 
+    {
+	const T zt1 = this->z_ + t1_;
+	if ( cacheNodes_ ) 
+	{
+	    if ( n == 0 || int(nodes_.size()) != n || 
+	         memcmp(&nodes_[0], rhoNAsq, n*sizeof(T)) != 0 ) 
+	    {
+		nodes_.assign(rhoNAsq, rhoNAsq + n);
+		slope_.resize(n);
+		depthSlope_.resize(n);
+		base_.resize(n);
+		for ( int i = 0; i < n; i++ ) 
+		{
+		    T x = rhoNAsq[i];
+		    T tmp = sqrt(this->niasq_-x);
+		    slope_[i] = tmp;
+		    depthSlope_[i] = sqrt(this->nssq_-x)-niaons_*tmp;
+		    base_[i] = t2_*x
+			 - this->tid_*(sqrt(this->nidsq_-x)-niaonid_*tmp)
+			 + this->tga_*(sqrt(this->ngasq_-x)-niaonga_*tmp)
+			 -(this->tgd_*(sqrt(this->ngdsq_-x)-niaongd_*tmp));
+		}
+	    }
+	    const T ts = this->ts_;
+	    for ( int i = 0; i < n; i++ ) 
+	    {
+		y[i] = zt1*slope_[i] + ts*depthSlope_[i] + base_[i];
+	    }
+	    return;
+	}
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    T x = rhoNAsq[i];
+	    T tmp = sqrt(this->niasq_-x);
+	    y[i] = zt1*tmp+t2_*x
+		 + this->ts_*(sqrt(this->nssq_-x)-niaons_*tmp)
+		 - this->tid_*(sqrt(this->nidsq_-x)-niaonid_*tmp)
+		 + this->tga_*(sqrt(this->ngasq_-x)-niaonga_*tmp)
+		 -(this->tgd_*(sqrt(this->ngdsq_-x)-niaongd_*tmp));
+	}
+    };
+
+    virtual void amplitude( const T* rhoNAsq, T* y, int n ) 
+    {
+	const T limit = apertureLimit();
+	for ( int i = 0; i < n; i++ ) 
+	{
+	    y[i] = rhoNAsq[i] > limit ? 0.0 : 1.0;
+	}
+    };
+
+    virtual void cacheNodes( bool cacheNodes ) 
+    { 
+	cacheNodes_ = cacheNodes; 
+	nodes_.clear();
+    };
+
+    virtual T apertureLimit() 
+    {
+	T limit = this->niasq_;
+	if ( this->nssq_ < limit ) limit = this->nssq_;
+	if ( this->nidsq_ < limit ) limit = this->nidsq_;
+	if ( this->ngasq_ < limit ) limit = this->ngasq_;
+	if ( this->ngdsq_ < limit ) limit = this->ngdsq_;
+	return limit;
+    };
+
     T amplitude( T rhoNAsq ) {
 	if ( this->niasq_ < rhoNAsq || this->nssq_ < rhoNAsq || 
 	     this->nidsq_ < rhoNAsq || this->ngasq_ < rhoNAsq || this->ngdsq_ < rhoNAsq ) 
@@ -129,6 +205,11 @@ class opdXcosm : public opdBase<T> {
     T s4_;
     T i4_;
     T g5_;
+    bool cacheNodes_;
+    std::vector<T> nodes_;
+    std::vector<T> slope_;
+    std::vector<T> depthSlope_;
+    std::vector<T> base_;
 };
 
 }
@@ -165,17 +165,13 @@ void Psf<T>::evaluate(
     if ( eval_ == Psf<T>::EVAL_EXACT ) 
     {
 	    std::cout <<"exact evaluation" << std::endl;
-        if ( (evalType & MAGNITUDE) == MAGNITUDE ) completePSF_->rotate(true, MAGNITUDE, user_);
-		if ( (evalType & REAL) == REAL ) completePSF_->rotate(true, REAL, user_);
-		if ( (evalType & IMAGINARY) == IMAGINARY ) completePSF_->rotate(true, IMAGINARY, user_);
+        completePSF_->rotate(true, evalType, user_);
     } 
     else if ( eval_ == Psf<T>::EVAL_INTERPOLATION )
     {
         std::cout <<"interpolation evaluation" << std::endl;
 	    radialPSF_->evaluate(user_);
-		if ( (evalType & MAGNITUDE) == MAGNITUDE ) completePSF_->rotateAndSum(false, MAGNITUDE, user_);
-		if ( (evalType & REAL) == REAL ) completePSF_->rotateAndSum(false, REAL, user_);
-		if ( (evalType & IMAGINARY) == IMAGINARY ) completePSF_->rotateAndSum(false, IMAGINARY, user_);
+		completePSF_->rotateAndSum(false, evalType, user_);
         //completePSF_->rotateAndSum(true, user_);
     }
     else 
@@ -21,6 +21,10 @@
 #define _PSF_FUNCTOR_H
 
 #include "psf/functorComplex.h"
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <vector>
 
 namespace cosm {
 
@@ -29,17 +33,87 @@ class PsfFunctor : public FunctorComplex<T> {
 
   public:
 
+    // Quadrature used to evaluate the PSF integral
+    enum Integration {
+	INTEGRATION_DQAG = 0x0,
+	INTEGRATION_GAUSS_LEGENDRE = 0x1,
+	INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE = 0x2
+    };
+
     PsfFunctor() {};
     ~PsfFunctor() {};
 
+    using FunctorComplex<T>::evaluate;
+
+    // Evaluates the PSF at the n points (z[i], r[i]). The points are
+    // visited in order of increasing z so that functors which keep
+    // z-dependent state (the OPD and its phase at the quadrature
+    // nodes) compute it once per distinct z and share it across all
+    // radii at that z. Subclasses may override this to do better.
+    virtual void evaluate( const T* z, const T* r, std::complex<T>* out, size_t n ) 
+    {
+	bool sorted = true;
+	for ( size_t i = 1; i < n && sorted; i++ ) 
+	{
+	    sorted = !(z[i] < z[i-1]);
+	}
+	if ( sorted ) 
+	{
+	    for ( size_t i = 0; i < n; i++ ) 
+	    {
+		out[i] = (*this)(z[i], r[i]);
+	    }
+	    return;
+	}
+	order_.resize(n);
+	for ( size_t i = 0; i < n; i++ ) 
+	{
+	    order_[i] = i;
+	}
+	std::stable_sort(order_.begin(), order_.end(), ZLess(z));
+	for ( size_t i = 0; i < n; i++ ) 
+	{
+	    size_t j = order_[i];
+	    out[j] = (*this)(z[j], r[j]);
+	}
+    };
+
     virtual bool isSymmetric() { return false; };
 
+    // Functors with a single quadrature ignore this
+    virtual void integration( Integration ) {};
+
+    // Changes the emission wavelength. Functors with a fixed
+    // wavelength ignore this.
+    virtual void wavelength( T ) {};
+
+    // Changes the depth of the point source in the specimen layer (the
+    // specimen thickness ts). Returns false if the functor cannot, in
+    // which case a new functor has to be created for the new depth.
+    virtual bool depth( T ) { return false; };
+
+    // Returns a new functor that evaluates the same PSF with state of
+    // its own, so that another thread can use it. The caller takes
+    // ownership. Returns NULL if the functor cannot be copied.
+    virtual PsfFunctor<T>* clone() { return NULL; };
+
   protected:
 
+    struct ZLess 
+    {
+	ZLess( const T* z ) : z_(z) {};
+	bool operator()( size_t i, size_t j ) const { return z_[i] < z_[j]; };
+	const T* z_;
+    };
+
     // not allowed
     PsfFunctor( PsfFunctor<T>& );
     PsfFunctor& operator=( PsfFunctor<T>& );
 
+  protected:
+
+    std::vector<size_t> order_;
+
 };
 };
 
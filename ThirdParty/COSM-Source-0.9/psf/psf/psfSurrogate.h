@@ -0,0 +1,280 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// Surrogate of a PsfFunctor over a (z, r) domain. The domain is split
+// into a uniform grid of cells and the complex PSF is approximated in
+// each cell by a tensor product Chebyshev series of the given degree.
+// The grid is refined in z and r until the trailing coefficients of
+// every cell are below the tolerance, so the fit costs a few thousand
+// evaluations of the PSF once and each later evaluation costs about
+// 4*(Degree+1)^2 flops with no branches. Points outside the domain are
+// clamped to it.
+
+#ifndef _PSF_SURROGATE_H
+#define _PSF_SURROGATE_H
+
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+
+#include "psf/psfFunctor.h"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace cosm {
+
+template<typename T, int Degree = 8>
+class PsfSurrogate : public PsfFunctor<T> {
+
+  public:
+
+    PsfSurrogate(
+	PsfFunctor<T>& psf,	// functor to approximate
+	T zMin,			// domain in z
+	T zMax,
+	T rMax,			// domain in r is [0, rMax]
+	T tolerance,		// relative to the largest |psf| sampled
+	int maxCells = 4096	// largest number of cells in the grid
+    ) : PsfFunctor<T>(), zMin_(zMin), zMax_(zMax), rMax_(rMax), 
+	symmetric_(psf.isSymmetric()), converged_(false), error_(0)
+    {
+	if ( zMax_ <= zMin_ ) zMax_ = zMin_ + 1;
+	if ( rMax_ <= 0 ) rMax_ = 1;
+	fit(psf, tolerance, maxCells);
+    };
+
+    ~PsfSurrogate() {};
+
+    virtual std::complex<T> operator()( T z, T r ) 
+    {
+	T u = (z - zMin_) * zScale_;
+	T v = r * rScale_;
+	u = u < 0 ? T(0) : (u > nz_ ? T(nz_) : u);
+	v = v < 0 ? T(0) : (v > nr_ ? T(nr_) : v);
+	int i = int(u);
+	int j = int(v);
+	i = i < nz_ - 1 ? i : nz_ - 1;
+	j = j < nr_ - 1 ? j : nr_ - 1;
+	T tz[N];
+	T tr[N];
+	chebyshev(2 * (u - i) - 1, tz);
+	chebyshev(2 * (v - j) - 1, tr);
+
+	const T* re = &re_[(i * nr_ + j) * N * N];
+	const T* im = &im_[(i * nr_ + j) * N * N];
+	T sumRe = 0;
+	T sumIm = 0;
+	for ( int k = 0; k < N; k++ ) 
+	{
+	    T rowRe = 0;
+	    T rowIm = 0;
+	    for ( int l = 0; l < N; l++ ) 
+	    {
+		rowRe += re[k*N+l] * tr[l];
+		rowIm += im[k*N+l] * tr[l];
+	    }
+	    sumRe += tz[k] * rowRe;
+	    sumIm += tz[k] * rowIm;
+	}
+	return std::complex<T>(sumRe, sumIm);
+    };
+
+    using PsfFunctor<T>::evaluate;
+
+    // The surrogate has no z-dependent state, so the points are
+    // evaluated in the given order without virtual calls.
+    virtual void evaluate( const T* z, const T* r, std::complex<T>* out, size_t n ) 
+    {
+	for ( size_t i = 0; i < n; i++ ) 
+	{
+	    out[i] = PsfSurrogate<T, Degree>::operator()(z[i], r[i]);
+	}
+    };
+
+    virtual bool isSymmetric() { return symmetric_; };
+
+    // true if the tolerance was met with at most maxCells cells
+    bool converged() { return converged_; };
+
+    // estimated largest absolute error of the surrogate
+    T error() { return error_; };
+
+    int zCells() { return nz_; };
+    int rCells() { return nr_; };
+
+  protected:
+
+    enum { N = Degree + 1 };
+
+    // Chebyshev polynomials T0..TDegree at x
+    static void chebyshev( T x, T* t ) 
+    {
+	t[0] = 1;
+	t[1] = x;
+	for ( int k = 2; k < N; k++ ) 
+	{
+	    t[k] = 2 * x * t[k-1] - t[k-2];
+	}
+    };
+
+    void fit( PsfFunctor<T>& psf, T tolerance, int maxCells ) 
+    {
+	// Chebyshev nodes and the polynomials at the nodes
+	T nodes[N];
+	T poly[N][N];
+	for ( int k = 0; k < N; k++ ) 
+	{
+	    nodes[k] = cos(M_PI * (k + 0.5) / N);
+	    for ( int i = 0; i < N; i++ ) 
+	    {
+		poly[i][k] = cos(M_PI * i * (k + 0.5) / N);
+	    }
+	}
+
+	nz_ = 1;
+	nr_ = 1;
+	std::vector<T> zs(N * N);
+	std::vector<T> rs(N * N);
+	std::vector< std::complex<T> > samples(N * N);
+	std::vector< std::complex<T> > partial(N * N);
+	while ( true ) 
+	{
+	    T hz = (zMax_ - zMin_) / nz_;
+	    T hr = rMax_ / nr_;
+	    zScale_ = 1 / hz;
+	    rScale_ = 1 / hr;
+	    re_.assign(nz_ * nr_ * N * N, T(0));
+	    im_.assign(nz_ * nr_ * N * N, T(0));
+
+	    T maxValue = 0;
+	    T zTail = 0;
+	    T rTail = 0;
+	    for ( int i = 0; i < nz_; i++ ) 
+	    {
+		T zc = zMin_ + (i + 0.5) * hz;
+		for ( int j = 0; j < nr_; j++ ) 
+		{
+		    T rc = (j + 0.5) * hr;
+		    // the samples of a cell are evaluated as one batch
+		    for ( int k = 0; k < N; k++ ) 
+		    {
+			for ( int l = 0; l < N; l++ ) 
+			{
+			    zs[k*N+l] = zc + 0.5 * hz * nodes[k];
+			    rs[k*N+l] = rc + 0.5 * hr * nodes[l];
+			}
+		    }
+		    psf.evaluate(&zs[0], &rs[0], &samples[0], N * N);
+		    for ( int k = 0; k < N * N; k++ ) 
+		    {
+			T value = std::abs(samples[k]);
+			if ( value > maxValue ) maxValue = value;
+		    }
+
+		    // discrete Chebyshev transform, first along r then z
+		    for ( int k = 0; k < N; k++ ) 
+		    {
+			for ( int b = 0; b < N; b++ ) 
+			{
+			    std::complex<T> sum = 0;
+			    for ( int l = 0; l < N; l++ ) 
+			    {
+				sum += samples[k*N+l] * poly[b][l];
+			    }
+			    partial[k*N+b] = sum * T(b == 0 ? 1.0 / N : 2.0 / N);
+			}
+		    }
+		    T* re = &re_[(i * nr_ + j) * N * N];
+		    T* im = &im_[(i * nr_ + j) * N * N];
+		    for ( int a = 0; a < N; a++ ) 
+		    {
+			for ( int b = 0; b < N; b++ ) 
+			{
+			    std::complex<T> sum = 0;
+			    for ( int k = 0; k < N; k++ ) 
+			    {
+				sum += partial[k*N+b] * poly[a][k];
+			    }
+			    sum *= T(a == 0 ? 1.0 / N : 2.0 / N);
+			    re[a*N+b] = sum.real();
+			    im[a*N+b] = sum.imag();
+			}
+		    }
+
+		    // the last two coefficients in each direction estimate
+		    // the truncation error in that direction
+		    T zSum = 0;
+		    T rSum = 0;
+		    for ( int a = 0; a < N; a++ ) 
+		    {
+			for ( int b = Degree - 1; b < N; b++ ) 
+			{
+			    zSum += std::abs(std::complex<T>(re[b*N+a], im[b*N+a]));
+			    rSum += std::abs(std::complex<T>(re[a*N+b], im[a*N+b]));
+			}
+		    }
+		    if ( zSum > zTail ) zTail = zSum;
+		    if ( rSum > rTail ) rTail = rSum;
+		}
+	    }
+
+	    T limit = tolerance * maxValue;
+	    error_ = zTail + rTail;
+	    converged_ = zTail <= limit && rTail <= limit;
+	    if ( converged_ ) 
+	    {
+		break;
+	    }
+	    int nz = zTail > limit ? 2 * nz_ : nz_;
+	    int nr = rTail > limit ? 2 * nr_ : nr_;
+	    if ( nz * nr > maxCells ) 
+	    {
+		break;
+	    }
+	    nz_ = nz;
+	    nr_ = nr;
+	}
+    };
+
+  protected:
+
+    // not allowed
+    PsfSurrogate( PsfSurrogate<T, Degree>& );
+    PsfSurrogate& operator=( PsfSurrogate<T, Degree>& );
+
+  protected:
+
+    T zMin_;
+    T zMax_;
+    T rMax_;
+    bool symmetric_;
+    bool converged_;
+    T error_;
+    int nz_;
+    int nr_;
+    T zScale_;
+    T rScale_;
+    std::vector<T> re_;		// coefficients per cell, [z degree][r degree]
+    std::vector<T> im_;
+
+};
+
+}
+
+#endif // _PSF_SURROGATE_H
@@ -0,0 +1,53 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// Helpers for the loops over planes that run in parallel with OpenMP.
+// Without OpenMP there is one thread and the loops run serially.
+
+#ifndef _PSF_THREADS_H
+#define _PSF_THREADS_H
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace cosm {
+
+// largest number of threads a parallel loop may use
+inline int maxThreads() 
+{ 
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+// number of the calling thread in the current parallel loop
+inline int threadNumber() 
+{ 
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+}
+
+#endif // _PSF_THREADS_H
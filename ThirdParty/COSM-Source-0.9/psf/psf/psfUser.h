@@ -36,6 +36,12 @@ public:
 public:
     PsfUser() {};
     virtual ~PsfUser() {};
+    // Called with the number of planes done so far. The planes may be
+    // done by several threads, but update() is only called from the
+    // thread that started the computation (the OpenMP master thread),
+    // so a GUI can be updated from it when the computation runs on
+    // the GUI thread. Some counts may be skipped; the last call has
+    // count equal to total.
     virtual void update( Type type, int count, int total) 
     { std::cout << (type == RADIAL ? "RADIAL" : "COMPLETE") <<", count: "<< count <<", total: "<< total << std::endl; };
 
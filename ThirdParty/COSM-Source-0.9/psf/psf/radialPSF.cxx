@@ -17,7 +17,9 @@
  *
  ****************************************************************************/
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 namespace cosm {
 
@@ -28,24 +30,37 @@ void RadialPSF<T>::evaluate(
 {
     int Nz = psf_.length(0);
     int Nr = psf_.length(1);
-    T zdist = 0;
-    T rdist = 0;
     // the first half of z dimension has postive z, the second half negative
     int halfNz = Nz/2;
     // only need to calculate positive z if symmetric
     int zMax = symmetric_ ? halfNz : Nz-1;
+    // the radial abscissae are the same for every plane, and each
+    // plane is evaluated as one batch so the functor can share its
+    // z-dependent terms across the radii. The planes are independent,
+    // so each thread evaluates whole planes with its own functor.
+    int threads = this->threads();
+    int completed = 0;
+    int reported = -1;
+#pragma omp parallel num_threads(threads)
+    {
+    PsfFunctor<T>* functor = this->functor(threadNumber());
+    std::vector<T> zs(Nr);
+    std::vector< complex<T> > values(Nr);
+#pragma omp for schedule(dynamic)
     for ( int z = 0; z <= zMax; z++ ) 
     {
-        zdist = (z > halfNz) ? (z-Nz) * deltaZ_ : z * deltaZ_;
+        T zdist = (z > halfNz) ? (z-Nz) * deltaZ_ : z * deltaZ_;
         //std::cout <<"RadialPSF::evaluate; plane: "<<z<<", dz: "<<zdist<< std::endl;
+        std::fill(zs.begin(), zs.end(), zdist);
+        functor->evaluate(&zs[0], &radii_[0], &values[0], Nr);
         for ( int r = 0; r < Nr; r++ ) 
         {
-	        rdist = r * deltaR_;
-            complex<T> value = (*functor_)(zdist,rdist);
+            complex<T> value = values[r];
             psf_(z,r) = norm(value);
 	        psfRe_(z,r) = value.real();
             psfIm_(z,r) = value.imag();
-            if ( symmetric_ && z > 0 ) 
+            // the middle plane of an even Nz is its own mirror
+            if ( symmetric_ && z > 0 && Nz-z != z ) 
             {
                 psf_(Nz-z, r) = psf_(z,r);
                 psfRe_(Nz-z, r) = psfRe_(z,r);
@@ -57,9 +72,23 @@ void RadialPSF<T>::evaluate(
         //std::cout <<z+halfNz<<" "<<psf_(z,Range::all())<< std::endl;
         if ( user != NULL ) 
         {
-            user->update(PsfUser::RADIAL, z, zMax);
+            int count;
+#pragma omp critical(cosm_psf_user)
+            count = completed++;
+            // the user may not be thread safe, only the calling
+            // (master) thread reports progress
+            if ( threadNumber() == 0 )
+            {
+                user->update(PsfUser::RADIAL, count, zMax);
+                reported = count;
+            }
 	    }
 	}
+    }
+    if ( user != NULL && reported != zMax ) 
+    {
+        user->update(PsfUser::RADIAL, zMax, zMax);
+    }
 }
 
 }
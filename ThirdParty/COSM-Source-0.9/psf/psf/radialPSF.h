@@ -25,11 +25,11 @@
 #endif
 
 #include "psf/psfUser.h"
-#include "psf/functorComplex.h"
-#include "psf/bilinearInterpolator.h"
-//#include "psf/splineInterpolator.h"
-//#include "psf/ratInterpolator.h"
+#include "psf/psfFunctor.h"
+#include "psf/psfThreads.h"
 #include <blitz/array.h>
+#include <complex>
+#include <vector>
 
 using namespace blitz;
 namespace cosm {
@@ -53,7 +53,7 @@ class RadialPSF {
         T deltaXY,
         T deltaZ,
         T deltaXYNyq,
-        FunctorComplex<T>* functor,
+        PsfFunctor<T>* functor,
         bool symmetric,
         int maxOversampling = 32
     ) : functor_(functor),
@@ -64,13 +64,18 @@ class RadialPSF {
 	deltaR_(0), deltaXY_(deltaXY), deltaZ_(deltaZ), 
 	deltaXYNyq_(deltaXYNyq),
 	maxOversampling_(maxOversampling), 
-	oversampling_(1), undersampled_(false), symmetric_(symmetric),
-	interpolator_(0,0,0), z_(-1)
+	oversampling_(1), undersampled_(false), symmetric_(symmetric)
     {
         sampling();
     };
 
-    ~RadialPSF() {};
+    ~RadialPSF() 
+    {
+        for ( size_t i = 0; i < clones_.size(); i++ )
+        {
+            delete clones_[i];
+        }
+    };
 
     void evaluate(
         PsfUser* user = NULL
@@ -105,29 +110,104 @@ class RadialPSF {
 		}
 		return 0;
     };
+
+    // PSF at n points of plane z given their distance r from the
+    // optical axis. All points are evaluated in one batch with the
+    // functor of the given thread.
+    void exactValues( int z, const T* r, complex<T>* values, int n, int thread = 0 )
+    {
+        T zdist = (z > nZ_/2) ? (z-nZ_)*deltaZ_ : z*deltaZ_;
+        std::vector<T> zs(n, zdist);
+        if ( n > 0 ) 
+        {
+            functor(thread)->evaluate(&zs[0], r, values, n);
+        }
+    };
+
+    // Number of threads that may evaluate planes at the same time.
+    // Each thread has its own functor: thread 0 the one given to the
+    // constructor and the others clones of it, made the first time
+    // this is called. If the functor cannot be cloned, one thread.
+    int threads( void )
+    {
+        int n = maxThreads();
+        while ( int(clones_.size()) < n-1 )
+        {
+            PsfFunctor<T>* clone = functor_->clone();
+            if ( clone == NULL ) 
+            {
+                break;
+            }
+            clones_.push_back(clone);
+        }
+        return int(clones_.size()) + 1;
+    };
+
+    PsfFunctor<T>* functor( int thread ) 
+    { 
+        return thread == 0 ? functor_ : clones_[thread-1]; 
+    };
                                                                                 
-    T interpolatedValue( int z, int y, int x, int oversampling = 1, EvalType type = MAGNITUDE )
+    // Linear interpolation of plane z at (y, x) in units of deltaXY
+    // divided by the oversampling. The plane is read in place and
+    // nothing is cached, so several threads may call it at once.
+    T interpolatedValue( int z, int y, int x, int oversampling = 1, EvalType type = MAGNITUDE ) const
     {
         T sq = (deltaXY_ * deltaXY_)/T(oversampling * oversampling);
         T r = sqrt(y*y*sq+x*x*sq);
-        if ( z != z_ ) {
-            z_ = z;
-            slice_.resize(nR_);
-			switch (type) 
-			{
-			    case MAGNITUDE: slice_ = psf_(z,Range::all()); break;
-			    case REAL: slice_ = psfRe_(z,Range::all()); break;
-			    case IMAGINARY: slice_ = psfIm_(z,Range::all()); break;
-            }
-            T* ra = new T[nR_];
-            for ( int i = 0; i < nR_; i++ )
-            {
-                ra[i] = i*deltaR_;
-            }
-            interpolator_.setValues((T*)(ra), (T*)(slice_.data()), nR_);
+        return interpolate(slice(z, type), r);
+    };
+
+    // Values of plane z at the radial abscissae, i*deltaR for i < nR.
+    const T* slice( int z, EvalType type = MAGNITUDE ) const
+    {
+        switch ( type ) 
+        {
+            case REAL: return psfRe_.data() + z*psfRe_.stride(0);
+            case IMAGINARY: return psfIm_.data() + z*psfIm_.stride(0);
+            default: break;
         }
-	T val = interpolator_(r);
-        return val;
+        return psf_.data() + z*psf_.stride(0);
+    };
+
+    // Linear interpolation of the slice at distance r from the axis.
+    // Returns 0 beyond the last abscissa.
+    T interpolate( const T* slice, T r ) const
+    {
+        int i;
+        T w0;
+        T w1;
+        interpolationWeights(r, i, w0, w1);
+        return w0*slice[i] + w1*slice[i+1];
+    };
+
+    // Index i and the weights of slice[i] and slice[i+1] in the linear
+    // interpolation at distance r from the axis. They do not depend on
+    // the plane. The abscissae are uniform, so the interval is found
+    // directly rather than searched for. Both weights are 0 beyond the
+    // last abscissa.
+    void interpolationWeights( T r, int& i, T& w0, T& w1 ) const
+    {
+        const T* ra = &radii_[0];
+        i = int(r/deltaR_);
+        i = i < 0 ? 0 : (i > nR_-1 ? nR_-1 : i);
+        // correct the rounding of the division
+        while ( i > 0 && ra[i] > r ) i--;
+        while ( i < nR_-1 && ra[i+1] <= r ) i++;
+        if ( i == nR_-1 && ra[i] == r ) 
+        {
+            i--;
+        }
+        if ( r < ra[0] || i >= nR_-1 ) 
+        {
+            i = 0;
+            w0 = 0;
+            w1 = 0;
+            return;
+        }
+        T h = ra[i+1]-ra[i];
+        w0 = (ra[i+1]-r)/h;
+        w1 = (r-ra[i])/h;
     };
 
   private:
@@ -167,6 +247,11 @@ class RadialPSF {
         psf_.resize(psf_.length(0), nR_);
 		psfRe_.resize(psf_.length(0), nR_);
 		psfIm_.resize(psf_.length(0), nR_);
+        radii_.resize(nR_);
+        for ( int i = 0; i < nR_; i++ )
+        {
+            radii_[i] = i*deltaR_;
+        }
         cout <<"undersampled: "<< (undersampled_ ? "true" : "false") << endl;
         cout <<"oversampling: "<< oversampling_ << endl;
         cout <<"deltar: "<< deltaR_ <<", Nr: "<< nR_ << endl;
@@ -180,7 +265,7 @@ class RadialPSF {
 
   private:
 
-    FunctorComplex<T>* functor_;
+    PsfFunctor<T>* functor_;
     Array<T,2> psf_;
 	Array<T,2> psfRe_;
 	Array<T,2> psfIm_;
@@ -195,11 +280,8 @@ class RadialPSF {
     int oversampling_;
     bool undersampled_;
     bool symmetric_;
-    BilinearInterpolator<T> interpolator_;
-    //SplineInterpolator<T> interpolator_;
-    //RatInterpolator<T> interpolator_;
-    int z_;
-    Array<T,1> slice_;
+    std::vector<T> radii_;	// radial abscissae, i*deltaR_
+    std::vector<PsfFunctor<T>*> clones_;	// functors of threads 1, 2, ...
 
 };
 
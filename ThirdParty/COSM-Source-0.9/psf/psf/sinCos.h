@@ -0,0 +1,76 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// Branch-free sine and cosine of the same argument. The argument is
+// reduced to [-pi/4, pi/4] with a three-part pi/4 (Cody-Waite) and the
+// octant is selected with arithmetic instead of branches, so loops
+// calling sinCos() can be vectorized by the compiler. Based on the
+// Cephes sin/cos polynomials. The reduction is done in double also for
+// float, a float reduction loses about log2(|x|) bits. The absolute
+// error is below 1e-7 for float with |x| < 1e7 and about 2e-16 for
+// double with |x| < 1e9; larger arguments are not supported.
+
+#ifndef _SIN_COS_H
+#define _SIN_COS_H
+
+#include <cmath>
+
+namespace cosm {
+
+template<typename T>
+inline void sinCos( T x, T& s, T& c ) 
+{
+    const double DP1 = 7.85398125648498535156E-1;
+    const double DP2 = 3.77489470793079817668E-8;
+    const double DP3 = 2.69515142907905952645E-15;
+    const T FOPI = T(1.27323954473516268615);  // 4/pi
+
+    T ax = x < 0 ? -x : x;
+    // octant, rounded up to an even number
+    // (truncation instead of floor() since the arguments are not
+    // negative and floor() does not vectorize without -fno-trapping-math)
+    T y = T(int(ax * FOPI));
+    y += y - 2 * T(int(y * T(0.5)));
+    // quadrant 0..3
+    T q = y * T(0.5) - 4 * T(int(y * T(0.125)));
+
+    const double yd = y;
+    T z = T(((double(ax) - yd * DP1) - yd * DP2) - yd * DP3);
+    T zz = z * z;
+    T ps = z + z * zz * (((((T(1.58962301576546568060E-10) * zz 
+	- T(2.50507477628578072866E-8)) * zz + T(2.75573136213857245213E-6)) * zz 
+	- T(1.98412698295895385996E-4)) * zz + T(8.33333333332211858878E-3)) * zz 
+	- T(1.66666666666666307295E-1));
+    T pc = 1 - T(0.5) * zz + zz * zz * (((((-T(1.13585365213876817300E-11) * zz 
+	+ T(2.08757008419747316778E-9)) * zz - T(2.75573141792967388112E-7)) * zz 
+	+ T(2.48015872888517045348E-5)) * zz - T(1.38888888888730564116E-3)) * zz 
+	+ T(4.16666666666665929218E-2));
+
+    // quadrants 1 and 3 swap sin and cos, 2 and 3 negate sin and
+    // 1 and 2 negate cos
+    T odd = q - 2 * T(int(q * T(0.5)));
+    T sv = odd == 1 ? pc : ps;
+    T cv = odd == 1 ? ps : pc;
+    T sign = x < 0 ? T(-1) : T(1);
+    s = q >= 2 ? -sign * sv : sign * sv;
+    c = (q - T(0.5)) * (q - T(2.5)) < 0 ? -cv : cv;
+}
+
+}
+
+#endif // _SIN_COS_H
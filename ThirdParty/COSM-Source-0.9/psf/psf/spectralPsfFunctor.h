@@ -0,0 +1,136 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+
+// PSF of a broadband emitter: the intensity is the weighted sum of the
+// intensities at a list of wavelengths. The wrapped functor is switched
+// between the wavelengths with PsfFunctor::wavelength(), which keeps
+// every wavelength-independent term (the pupil angles, the Fresnel
+// coefficients, the amplitude and the OPD at the quadrature nodes), so
+// each extra wavelength costs only its phase and its Bessel functions.
+// Batches are evaluated one wavelength at a time so that the phase at
+// a given z is also shared across all radii at that z.
+//
+// The emission of different wavelengths is incoherent, so only the
+// intensity is defined: the value returned is real and its norm() is
+// the weighted intensity.
+
+#ifndef _SPECTRAL_PSF_FUNCTOR_H
+#define _SPECTRAL_PSF_FUNCTOR_H
+
+#include "psf/psfFunctor.h"
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace cosm {
+
+template<typename T>
+class SpectralPsfFunctor : public PsfFunctor<T> {
+
+  public:
+
+    // Takes ownership of psf. The weights are normalized to sum to one
+    // so that a single wavelength gives the monochromatic PSF.
+    SpectralPsfFunctor(
+	PsfFunctor<T>* psf,			// functor at any wavelength
+	const std::vector<T>& wavelengths,
+	const std::vector<T>& weights		// relative emission
+    ) : PsfFunctor<T>(), psf_(psf), wavelengths_(wavelengths), 
+	weights_(wavelengths.size(), T(0))
+    {
+	T total = 0;
+	for ( size_t l = 0; l < weights_.size() && l < weights.size(); l++ ) 
+	{
+	    total += weights[l];
+	}
+	for ( size_t l = 0; l < weights_.size() && l < weights.size(); l++ ) 
+	{
+	    weights_[l] = total > 0 ? weights[l] / total : T(0);
+	}
+    };
+
+    ~SpectralPsfFunctor() { delete psf_; };
+
+    virtual std::complex<T> operator()( T z, T r ) 
+    {
+	T intensity = 0;
+	for ( size_t l = 0; l < wavelengths_.size(); l++ ) 
+	{
+	    psf_->wavelength(wavelengths_[l]);
+	    intensity += weights_[l] * norm((*psf_)(z, r));
+	}
+	return std::complex<T>(sqrt(intensity), 0);
+    };
+
+    using PsfFunctor<T>::evaluate;
+
+    virtual void evaluate( const T* z, const T* r, std::complex<T>* out, size_t n ) 
+    {
+	intensity_.assign(n, T(0));
+	values_.resize(n);
+	for ( size_t l = 0; l < wavelengths_.size() && n > 0; l++ ) 
+	{
+	    psf_->wavelength(wavelengths_[l]);
+	    psf_->evaluate(z, r, &values_[0], n);
+	    for ( size_t i = 0; i < n; i++ ) 
+	    {
+		intensity_[i] += weights_[l] * norm(values_[i]);
+	    }
+	}
+	for ( size_t i = 0; i < n; i++ ) 
+	{
+	    out[i] = std::complex<T>(sqrt(intensity_[i]), 0);
+	}
+    };
+
+    virtual bool isSymmetric() { return psf_->isSymmetric(); };
+
+    virtual bool depth( T ts ) { return psf_->depth(ts); };
+
+    virtual PsfFunctor<T>* clone() 
+    { 
+	PsfFunctor<T>* psf = psf_->clone();
+	return psf == NULL ? NULL : 
+	    new SpectralPsfFunctor<T>(psf, wavelengths_, weights_);
+    };
+
+    virtual void integration( typename PsfFunctor<T>::Integration integration ) 
+    {
+	psf_->integration(integration);
+    };
+
+  protected:
+
+    // not allowed
+    SpectralPsfFunctor( SpectralPsfFunctor<T>& );
+    SpectralPsfFunctor& operator=( SpectralPsfFunctor<T>& );
+
+  protected:
+
+    PsfFunctor<T>* psf_;
+    std::vector<T> wavelengths_;
+    std::vector<T> weights_;
+    std::vector<T> intensity_;
+    std::vector< std::complex<T> > values_;
+
+};
+
+}
+
+#endif // _SPECTRAL_PSF_FUNCTOR_H
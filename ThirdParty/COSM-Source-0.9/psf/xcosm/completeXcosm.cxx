@@ -21,12 +21,8 @@
 #include "string.h"
 #include "blitz/arrayManip.h"
 #include "wu/wuHeader.h"
-
-extern "C" {
-    extern float deltar;
-    extern float deltaxy;
-    extern float deltaxy_nyq;
-};
+#include <new>
+#include <stdexcept>
 
 using namespace blitz;
 
@@ -35,6 +31,11 @@ namespace cosm {
 template<typename T>
 void packHead( RadialPSF<T>* radialPSF,  float* radial, osm_ds& head, int nR, int nZ );
 
+template<typename T>
+void packContext( RadialPSF<T>* radialPSF, xcosm_ctx& ctx );
+
+inline void checkStatus( int status );
+
 template<typename T>
 void CompleteXcosm<T>::rotate(
     bool exact,
@@ -58,43 +59,41 @@ void CompleteXcosm<T>::rotate(
     osm_ds head;
 	packHead( this->radialPSF_, radial_.data(),  head, nR, nZ);
 
-    // additional global parameters!    
-    deltar = (float) this->radialPSF_->deltaR();
-    deltaxy = (float) this->radialPSF_->deltaXY();
-    deltaxy_nyq = (float) this->radialPSF_->deltaXYNyq();
+    xcosm_ctx ctx;
+    packContext( this->radialPSF_, ctx );
 	
 	double distance = (double)distance_ == 0 || distance_ > 1e15 ? 
         1e20  :							/* single aperture use huge distance */
         distance / (lm_ * magY_ * 1E3);  /* convert to mm in object space */
 		
     double fsize = (double)fsize_/(lm_ * magY_ * 1E3); /* convert to mm in object space */
-    bool use2Photon =  this->type_ == CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE && fsize < deltaxy ? true : false;
+    bool use2Photon =  this->type_ == CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE && fsize < ctx.deltaxy ? true : false;
 
-    fsize = fsize/deltar < 0 ? 1 : fsize/deltar;
-	distance = distance/deltar < 0 ? 1 : distance/deltar;	
+    fsize = fsize/ctx.deltar < 0 ? 1 : fsize/ctx.deltar;
+	distance = distance/ctx.deltar < 0 ? 1 : distance/ctx.deltar;	
 
     switch ( this->type_ )
     {
         case OPTICAL_SECTIONING_WIDEFIELD:
-	    rotnone(complete_.data(), &head);
+	    checkStatus(rotnone(&ctx, complete_.data(), &head));
             break;
         case OPTICAL_SECTIONING_2_PHOTON: 
-	    rotnone(complete_.data(), &head);
+	    checkStatus(rotnone(&ctx, complete_.data(), &head));
             complete_ = complete_ * complete_;
             break;
         case CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE:
             if ( use2Photon )
             {
-			    rotnone(complete_.data(), &head);
+			    checkStatus(rotnone(&ctx, complete_.data(), &head));
 				complete_ = complete_ * complete_;
             }
             else
             {
-                rotdiskcirc(complete_.data(),&head,1,distance,fsize,0);   
+                checkStatus(rotdiskcirc(&ctx,complete_.data(),&head,1,distance,fsize,0));   
             }
             break;
         case CONFOCAL_ROTATING_DISK_LINE_APERTURE: 
-            rotdiskline(complete_.data(),&head,1,distance,fsize,0); 
+            checkStatus(rotdiskline(&ctx,complete_.data(),&head,1,distance,fsize,0)); 
             break;
         case DIC:
 		case DIC_2D:
@@ -133,10 +132,8 @@ void CompleteXcosm<T>::rotateAndSum(
     osm_ds head;
 	packHead( this->radialPSF_, radial_.data(),  head, nR, nZ);
 
-    // additional global parameters!  
-    deltar = (float) this->radialPSF_->deltaR();
-    deltaxy = (float) this->radialPSF_->deltaXY();
-    deltaxy_nyq = (float) this->radialPSF_->deltaXYNyq();
+    xcosm_ctx ctx;
+    packContext( this->radialPSF_, ctx );
 
     double distance = (double)distance_ == 0 || distance_ > 1e15 ? 
         1e20  :							/* single aperture use huge distance */
@@ -144,33 +141,33 @@ void CompleteXcosm<T>::rotateAndSum(
 		
     double fsize = (double)fsize_/(lm_ * magY_ * 1E3); /* convert to mm in object space */
     
-    bool use2Photon =  this->type_ == CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE && fsize < deltaxy ? true : false;
+    bool use2Photon =  this->type_ == CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE && fsize < ctx.deltaxy ? true : false;
 
-    fsize = fsize/deltar < 0 ? 1 : fsize/deltar;
-	distance = distance/deltar < 0 ? 1 : distance/deltar;	
+    fsize = fsize/ctx.deltar < 0 ? 1 : fsize/ctx.deltar;
+	distance = distance/ctx.deltar < 0 ? 1 : distance/ctx.deltar;	
 
     switch ( this->type_ )
     {
         case OPTICAL_SECTIONING_WIDEFIELD:
-            rotsum(complete_.data(), &head);
+            checkStatus(rotsum(&ctx, complete_.data(), &head));
             break;
         case OPTICAL_SECTIONING_2_PHOTON:
-            rotsum(complete_.data(), &head);
+            checkStatus(rotsum(&ctx, complete_.data(), &head));
             complete_ = complete_ * complete_;
             break;
         case CONFOCAL_ROTATING_DISK_CIRCULAR_APERTURE:
             if ( use2Photon )
             {
-			    rotsum(complete_.data(), &head);
+			    checkStatus(rotsum(&ctx, complete_.data(), &head));
 				complete_ = complete_ * complete_;
             }
             else
             {
-                rdcircsum(complete_.data(),&head,1,distance,fsize,0);   
+                checkStatus(rdcircsum(&ctx,complete_.data(),&head,1,distance,fsize,0));   
             }
             break;
         case CONFOCAL_ROTATING_DISK_LINE_APERTURE:
-            rdlinesum(complete_.data(),&head,1,distance,fsize,0);
+            checkStatus(rdlinesum(&ctx,complete_.data(),&head,1,distance,fsize,0));
             break;
         case DIC:
 		case DIC_2D:
@@ -213,6 +210,8 @@ void CompleteXcosm<T>::rotateDIC( PsfUser* user )
     osm_ds headIm;
 	packHead( this->radialPSF_, radialRe_.data(),  headRe, nR, nZ);
 	packHead( this->radialPSF_, radialIm_.data(),  headIm, nR, nZ);
+    xcosm_ctx ctx;
+    packContext( this->radialPSF_, ctx );
 	
     if ( this->type_ == DIC_2D )
     {
@@ -220,7 +219,7 @@ void CompleteXcosm<T>::rotateDIC( PsfUser* user )
     }
     else
 	{
-        rotdicline(completeRe_.data(),completeIm_.data(),&headRe,&headIm,1,shear_,bias_,ampRatio_,0); 
+        checkStatus(rotdicline(&ctx,completeRe_.data(),completeIm_.data(),&headRe,&headIm,1,shear_,bias_,ampRatio_,0)); 
     }
     if ( user != NULL )
     {
@@ -297,5 +296,29 @@ void packHead( RadialPSF<T>* radialPSF, float* radial, osm_ds& head, int nR, int
     head.xlength = radialPSF->deltaR();
 }
 
+template<typename T>
+void packContext( RadialPSF<T>* radialPSF, xcosm_ctx& ctx )
+{
+    ctx.deltar = (float) radialPSF->deltaR();
+    ctx.deltaxy = (float) radialPSF->deltaXY();
+    ctx.deltaxy_nyq = (float) radialPSF->deltaXYNyq();
+    ctx.lognm = XCOSM_LOGNM;
+    ctx.psfnm = XCOSM_PSFNM;
+}
+
+// The kernels report failures instead of exiting; an allocation failure
+// is thrown like a failed blitz allocation would be.
+inline void checkStatus( int status )
+{
+    if ( status == XCOSM_NO_MEMORY )
+    {
+        throw std::bad_alloc();
+    }
+    if ( status != XCOSM_OK )
+    {
+        throw std::runtime_error("xcosm: radial PSF too short for the complete PSF");
+    }
+}
+
 
 };
@@ -0,0 +1,98 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ ****************************************************************************/
+/*
+
+FFT3D.C
+
+	FFTW plans for the xcosm kernels, see fft3d.h. They replace the
+radix-2 real_fft3d and fftn routines, so the transform sizes need not
+be powers of two.
+
+	Only fftwf_execute is thread safe in FFTW, creating and
+destroying plans is serialized with a mutex so that several PSFs can
+be completed at the same time. The plans use FFTW_ESTIMATE, which does
+not touch the arrays, so an array may already hold its data when it is
+planned.
+*/
+
+#include <stdio.h>
+#include "fft3d.h"
+
+#ifdef _WIN32
+#include <windows.h>
+static SRWLOCK planner_lock = SRWLOCK_INIT;
+#define LOCK_PLANNER()   AcquireSRWLockExclusive(&planner_lock)
+#define UNLOCK_PLANNER() ReleaseSRWLockExclusive(&planner_lock)
+#else
+#include <pthread.h>
+static pthread_mutex_t planner_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_PLANNER()   pthread_mutex_lock(&planner_lock)
+#define UNLOCK_PLANNER() pthread_mutex_unlock(&planner_lock)
+#endif
+
+fftwf_plan plan_rfft2d(int nx, int ny, float *data)
+{
+fftwf_plan plan;
+
+LOCK_PLANNER();
+plan = fftwf_plan_dft_r2c_2d(ny, nx, data, (fftwf_complex *)data,
+			     FFTW_ESTIMATE);
+UNLOCK_PLANNER();
+return(plan);
+}
+
+fftwf_plan plan_irfft2d(int nx, int ny, float *data)
+{
+fftwf_plan plan;
+
+LOCK_PLANNER();
+plan = fftwf_plan_dft_c2r_2d(ny, nx, (fftwf_complex *)data, data,
+			     FFTW_ESTIMATE);
+UNLOCK_PLANNER();
+return(plan);
+}
+
+/* FFTW has no sign argument for split arrays, the backward transform
+   is the forward one with the real and imaginary parts swapped */
+fftwf_plan plan_split_fft2d(int nx, int ny, float *re, float *im, int sign)
+{
+fftwf_plan plan;
+fftwf_iodim dims[2];
+
+dims[0].n = ny; dims[0].is = nx; dims[0].os = nx;
+dims[1].n = nx; dims[1].is = 1;  dims[1].os = 1;
+
+LOCK_PLANNER();
+if (sign == FFTW_FORWARD)
+   plan = fftwf_plan_guru_split_dft(2, dims, 0, NULL, re, im, re, im,
+				    FFTW_ESTIMATE);
+else
+   plan = fftwf_plan_guru_split_dft(2, dims, 0, NULL, im, re, im, re,
+				    FFTW_ESTIMATE);
+UNLOCK_PLANNER();
+return(plan);
+}
+
+void destroy_fft_plan(fftwf_plan plan)
+{
+if (plan == NULL) return;
+
+LOCK_PLANNER();
+fftwf_destroy_plan(plan);
+UNLOCK_PLANNER();
+}
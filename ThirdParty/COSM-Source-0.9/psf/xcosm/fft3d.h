@@ -3,26 +3,32 @@
 ****************************************************************************/
 #ifndef _FFT3D_H
 #define _FFT3D_H
+
+#include <fftw3.h>
+
 typedef struct {
 	float re;
 	float im;
 	} fcomplex;
 
-extern void real_fft3d(float *cplxdat, int nx, int ny, int nz, int xdim, int ydim, int dir);
+/* FFTW plans for the transforms of the xcosm kernels. A plan is created
+   once per array and executed with fftwf_execute() for every z-plane.
 
-#ifdef SGI_FFT
+   plan_rfft2d/plan_irfft2d transform in place an array of ny rows of
+   nx+2 floats (nx even), the first nx columns holding the real data.
+   On output of plan_rfft2d the array holds ny rows of nx/2+1 fcomplex.
+   The forward transform uses exp(-j...) and neither is normalized,
+   a forward followed by an inverse transform scales by nx*ny.
 
-#define FORWARD -1
-#define REVERSE  1
-#define FACTOR_SPACE	15
+   plan_split_fft2d transforms in place an nx by ny complex array whose
+   real and imaginary parts are in separate arrays. sign is FFTW_FORWARD
+   or FFTW_BACKWARD, again without normalization.
 
-extern void sscal3d( int nx, int ny, int nz, float alpha, float *y, int ld1,int ld2);
-extern float *sfft3dui( int n1, int n2, int n3, float *save);
-extern int sfft3du( int job, int n1, int n2, int n3, float *array, int ld1, int ld2, float *save);
-
-#else
-#define FORWARD  1
-#define REVERSE -1
-#endif
+   The routines return NULL if FFTW could not create the plan. */
+extern fftwf_plan plan_rfft2d(int nx, int ny, float *data);
+extern fftwf_plan plan_irfft2d(int nx, int ny, float *data);
+extern fftwf_plan plan_split_fft2d(int nx, int ny, float *re, float *im,
+				   int sign);
+extern void destroy_fft_plan(fftwf_plan plan);
 
 #endif
@@ -218,6 +218,29 @@ return (int) (log((double) number + 0.5) / ln2);
 }
 
 
+/******************************************************
+Return the smallest even integer greater than or equal
+to 'number' with no prime factors other than 2, 3, 5
+and 7. FFTW transforms of these sizes are about as fast
+as those of the next power of two, which can be nearly
+twice as large.
+*******************************************************/
+int fftsize(int number)
+{
+int	n, m;
+
+if (number < 2) return(2);
+for(n=number+(number&1);;n+=2){
+   m = n;
+   while (m%2 == 0) m /= 2;
+   while (m%3 == 0) m /= 3;
+   while (m%5 == 0) m /= 5;
+   while (m%7 == 0) m /= 7;
+   if (m == 1) return(n);
+   }
+}
+
+
 /*************************************************
 Append 'message' to end of logfile already opened in
 calling program. The message is written together
@@ -468,8 +491,10 @@ Nnr : (INPUT, int) Number of points in fr(r) (dimension of array fr)
 ratio: (INPUT, float)  ratio of sampling distances Dxy/Dr, where
 Dxy is the desired sampling in fxy(x,y) and Dr the available
 sampling in fr(r).  ratio must be strictly positive
+RETURNS:
+0, or 1 if fxy needs samples beyond the end of fr
 ************************************************************/
-void r2xy(float *fxy, float *fr, int Nnx, int Nny, int Nnr, float ratio)
+int r2xy(float *fxy, float *fr, int Nnx, int Nny, int Nnr, float ratio)
 {
 int	iy, ix, ir;
 float	x, y, rd, ysq;
@@ -499,12 +524,12 @@ for(iy=1;iy<=HalfNny+1;iy++){
          if (alpha > 1.0) {
             fprintf(stderr,"Error: alpha larger than 1.0 in r2xy\n");
             fprintf(stderr,"(ix,iy,alpha)=%d,%d,%f\n", ix, iy, alpha);
-            exit(1);
+            return(1);
          }
          else if(alpha < 0.0) {
             fprintf(stderr,"Error: alpha smaller than 0.0 in r2xy\n");
             fprintf(stderr,"(ix,iy,alpha)=%d,%d,%f\n", ix, iy, alpha);
-            exit(1);
+            return(1);
          }
 /*       fxy(ix,iy) = fr(ir)*alpha + fr(ir+1)*(1.0-alpha)
          fxy(iy,ix) = fxy(ix,iy) */
@@ -515,12 +540,13 @@ for(iy=1;iy<=HalfNny+1;iy++){
       else {
          fprintf(stderr,"Error: ir larger than Nnr\n");
          fprintf(stderr,"(ix,iy,ir,Nnr=)%d,%d,%d,%d\n",ix,iy,ir,Nnr);
-         exit(1);
+         return(1);
       }
    }
 }
 /*   ..Replicate to the other three quadrants */
 evenrepr(fxy, Nnx, Nny);
+return(0);
 }
 
 
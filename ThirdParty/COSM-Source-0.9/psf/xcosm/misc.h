@@ -24,11 +24,12 @@ EXTERN void defaulter(char *prompt, float *var);
 EXTERN void getpupil(float *pupil, float diam, int nx, int ny);
 EXTERN void evenrepr(float *array, int nx, int ny);
 EXTERN int  intlog2(int number);
+EXTERN int  fftsize(int number);
 EXTERN void keeplog(FILE *fp, char *message);
 EXTERN void add2columns(float *pt, int nx, int nyz);
 EXTERN void mult3dcm(fcomplex *array1, fcomplex *array2, int siz);
 EXTERN void mult3drm(float *array1, float *array2, int siz);
 EXTERN void norm3dcm(fcomplex *array, float *peak, int siz);
 EXTERN void norm3drm(float *array, float *peak, int siz);
-EXTERN void r2xy(float *fxy, float *fr, int nx, int ny, int nr, float ratio);
+EXTERN int  r2xy(float *fxy, float *fr, int nx, int ny, int nr, float ratio);
 
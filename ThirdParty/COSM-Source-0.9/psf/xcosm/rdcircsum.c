@@ -31,31 +31,30 @@ support desired for hp(x,y,z)
 
 #include "misc.h"
 #include "washu.h"
+#include "xcosm.h"
 
-extern float deltaxy,deltaxy_nyq;
-extern float deltar;
-extern char prognm[];
-extern char psfnm[];
-extern char lognm[];
 extern void WritePlane(int plane, float *outvol, float *inslice, int w, int h, int inx, int iny);
 extern void ZeroOut(float *f,int siz);
 extern void Sum4N4NToNN(float *sorc, float *desti, int Ndim, int osmp); 
 
-void rdcircsum(float *outpsf, osm_ds *head, int bin,
+int rdcircsum(const xcosm_ctx *ctx, float *outpsf, osm_ds *head, int bin,
 		float distance, float size, int tandem)
 {
 int 		Nxy,Nz,Nr;
 int		ovrsmp;
 int		symmetric;
+int		status = XCOSM_OK;
 FILE		*logfp,*infofp;
 
-float		*pupil; 	/*   Pupil function and its Fourier transform */
+float		*pupil = NULL; 	/*   Pupil function and its Fourier transform */
 fcomplex	*Cpupil;
-float		*psfobj; 	/*   One (xy) plane of the objective's PSF    */
-float		*psfbin1; 	/*   One plane (xy) of the intermediate PSF   */
-float		*psfbin; 	/*   One plane (xy) of the final PSF          */
-float		*psfcond; 	/*   One plane of the condenser PSF           */
+float		*psfobj = NULL; /*   One (xy) plane of the objective's PSF    */
+float		*psfbin1 = NULL; /*   One plane (xy) of the intermediate PSF   */
+float		*psfbin = NULL; /*   One plane (xy) of the final PSF          */
+float		*psfcond = NULL; /*   One plane of the condenser PSF           */
 fcomplex	*otfcond;
+fftwf_plan	plan = NULL, 	/*   Transforms of the pupil and of psfcond   */
+		fwdplan = NULL, invplan = NULL;
 float		peak;		/*   Max. value of arrays (normalization)     */
 float		illum; 		/*   One sample of the illumination patern    */
 float		tmp;
@@ -91,6 +90,8 @@ int		Mxy, Halfway;
 int		Pxy;
 /*   normalized radial or lateral sampling rate */
 float		nrm_deltar, nrm_deltaxy=1.0;
+/*   real radial and lateral sampling rates (mm) */
+float		deltar, deltaxy, deltaxy_nyq;
 /*   new lateral sampling rate based on oversampling */
 float		deltaxy1;
 /*   oversampling rate for the xy plane */
@@ -130,6 +131,9 @@ psfxz     = (float*)head->data;
 ovrsmp    = head->xstart;
 Nxy       = head->ystart;
 symmetric = head->zstart;
+deltar      = ctx->deltar;
+deltaxy     = ctx->deltaxy;
+deltaxy_nyq = ctx->deltaxy_nyq;
 /* leave at 1.0
 nrm_deltar    = head->xlength;
 nrm_deltaxy   = head->ylength;
@@ -216,15 +220,13 @@ Maxir = (int) ((Maxrprime + 1.0)/nrm_deltar);
 appod = 1.0;
 if (Maxir > Nr) appod = 1.0/(float)(Maxir - Nr) ;
 
-/*   ..Calculate size of pupil function array at the higher resolution*/
-Pxy = Nxy*ovrsmp*bin;
-/*   ..Calculate the least power of 2 that will fit */
-Pxy = intlog2(Pxy-1);
-Pxy = (int) pow(2.0 , Pxy+1);
+/*   ..Calculate size of pupil function array at the higher resolution,
+	the least size FFTW transforms quickly that will fit */
+Pxy = fftsize(Nxy*ovrsmp*bin);
 
 /*   ..Make sure that the log file exists */
-if((logfp=fopen(lognm,"a"))==(FILE *)NULL) {
-   fprintf(stderr,"WARNING: (rotdiskcirc) can't open logfile `%s' for write.\n",lognm);
+if((logfp=fopen(ctx->lognm,"a"))==(FILE *)NULL) {
+   fprintf(stderr,"WARNING: (rotdiskcirc) can't open logfile `%s' for write.\n",ctx->lognm);
    logfp = stderr;
    }
 fprintf(logfp,"         Number of slices or planes: %d\n", Nz);
@@ -243,7 +245,7 @@ fprintf(logfp,"                                Vyy: %f\n",Vyy);
 fprintf(logfp,"even symmetry in z is %s assumed.\n", symmetric ? "":"NOT");
 
 
-   sprintf(temp_string,"%s.info",psfnm);
+   sprintf(temp_string,"%s.info",ctx->psfnm);
    if((infofp=fopen(temp_string,"a"))==(FILE *)NULL) 
       fprintf(stderr,"WARNING: can't open info file %s for write.\n",temp_string);
    else {
@@ -259,7 +261,7 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n", symmetric ? "":"NOT");
          }
 
 
-fprintf(stderr,"check file %s for progress report.\n",lognm);
+fprintf(stderr,"check file %s for progress report.\n",ctx->lognm);
 
 if (size >= 1.0) {
    keeplog (logfp, "sampling pupil function ");
@@ -267,8 +269,9 @@ if (size >= 1.0) {
    /* first allocate memory for array pupil */
    if((pupil=(float *)calloc(sizeof(float),((Pxy+2)*Pxy)))==
       (float *)NULL) {
-      fprintf(stderr,"out of memory in %s\n",prognm);
-      exit(1);
+      fprintf(stderr,"out of memory in rdcircsum\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
       }
    ZeroOut(pupil,(Pxy+2)*Pxy);
 
@@ -277,7 +280,12 @@ if (size >= 1.0) {
    add2columns(pupil,Pxy,Pxy);
 
    /* Fourier transform pupil function */
-   real_fft3d(pupil,Pxy,Pxy,1,Pxy+2,Pxy,FORWARD);
+   if((plan=plan_rfft2d(Pxy,Pxy,pupil))==(fftwf_plan)NULL) {
+      fprintf(stderr,"can't plan FFT in rdcircsum\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
+      }
+   fftwf_execute(plan);
    Cpupil=(fcomplex *)pupil;
 
    /* If tandem scanning, the equivalent pinhole function is the
@@ -287,12 +295,18 @@ if (size >= 1.0) {
    /* Normalize Cpupil array to avoid handling very small numbers */
    peak = 0.0;
    norm3dcm (Cpupil, &peak, Pxy*(Pxy+2)/2);
+
+   /* The inverse FFT is not normalized, divide by its scale here
+      once instead of in every plane */
+   peak = (float)Pxy*(float)Pxy;
+   norm3dcm (Cpupil, &peak, Pxy*(Pxy+2)/2);
    }
      
 /* allocate memory for psfobj. Notice size of array   */
 if((psfobj=(float *)calloc(sizeof(float),Mxy*Mxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rdcircsum\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfobj,Mxy*Mxy);
 
@@ -302,30 +316,45 @@ fflush(stdout);
 if (Mxy > Pxy){  /* when ovrsmp < 5 then this is true */
   printf("Mxy >Pxy\n");
   if((psfcond=(float *)calloc(sizeof(float),(Mxy+2)*Mxy))==(float *)NULL) {
-     fprintf(stderr,"out of memory in %s\n",prognm);
-     exit(1);
+     fprintf(stderr,"out of memory in rdcircsum\n");
+     status = XCOSM_NO_MEMORY;
+     goto done;
      }
 }
 else
   if((psfcond=(float *)calloc(sizeof(float),(Pxy+2)*Pxy))==(float *)NULL) {
-     fprintf(stderr,"out of memory in %s\n",prognm);
-     exit(1);
+     fprintf(stderr,"out of memory in rdcircsum\n");
+     status = XCOSM_NO_MEMORY;
+     goto done;
      }
 
 ZeroOut(psfcond,(Pxy+2)*Pxy);
 otfcond=(fcomplex *)psfcond;
 
+/* plan the transforms of psfcond once for all planes */
+if (size >= 1.0) {
+   fwdplan = plan_rfft2d(Pxy,Pxy,psfcond);
+   invplan = plan_irfft2d(Pxy,Pxy,psfcond);
+   if((fwdplan==(fftwf_plan)NULL)||(invplan==(fftwf_plan)NULL)) {
+      fprintf(stderr,"can't plan FFT in rdcircsum\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
+      }
+   }
+
 /* allocate memory for psfbin. Notice size of array   */
 if((psfbin=(float *)calloc(sizeof(float),Nxy*Nxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rdcircsum\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfbin,Nxy*Nxy);
 
 /* allocate memory for psfbi1. Notice size of array */
 if((psfbin1=(float *)calloc(sizeof(float),Lxy*Lxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rdcircsum\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
 }
 ZeroOut(psfbin1,Lxy*Lxy);
 
@@ -342,18 +371,24 @@ for(iz=1;iz<=Zup;iz++){
    radpsf = (psfxz + (iz-1)*Nr);
 
    /* Calculate the objective PSF (iterpolate rz section into xyz sect)*/
-   r2xy(psfobj, radpsf, Mxy, Mxy, Nr, ratio);
+   if(r2xy(psfobj, radpsf, Mxy, Mxy, Nr, ratio)) {
+      status = XCOSM_BAD_SAMPLING;
+      goto done;
+      }
 
    if (size >= 1.0) {
       /* Convolve condenser PSF and aperture */
       /* interpolate w/o subsampling */
-      r2xy(psfcond, radpsf, Pxy, Pxy, Nr, 1.0);
+      if(r2xy(psfcond, radpsf, Pxy, Pxy, Nr, 1.0)) {
+         status = XCOSM_BAD_SAMPLING;
+         goto done;
+         }
       add2columns(psfcond,Pxy,Pxy);
 
       /*  Fourier transform, multiply, inverse Fourier transform */
-      real_fft3d(psfcond,Pxy,Pxy,1,Pxy+2,Pxy,FORWARD);
+      fftwf_execute(fwdplan);
       mult3dcm(otfcond, Cpupil, (Pxy+2)*Pxy/2);
-      real_fft3d(psfcond,Pxy,Pxy,1,Pxy+2,Pxy,REVERSE);
+      fftwf_execute(invplan);
 
       /* Copy first line of convolution to radpsf to use for illumination */
       NetNr = Pxy/2+1;
@@ -483,15 +518,18 @@ for(iz=1;iz<=Zup;iz++){
 
 
 keeplog (logfp, "DONE");
-if(logfp != stderr) fclose(logfp);
 
-printf("don't free up the memory\n");
-/*free(radpsf);
+done:
+if(logfp != stderr) fclose(logfp);
+destroy_fft_plan(plan);
+destroy_fft_plan(fwdplan);
+destroy_fft_plan(invplan);
+free(psfbin1);
 free(psfbin);
 free(psfobj);
 free(psfcond);
-free(pupil);*/
-
+free(pupil);
+return(status);
 }
 
 
@@ -34,11 +34,8 @@ support desired for hp(x,y,z)
 
 #include "misc.h"
 #include "washu.h"
+#include "xcosm.h"
 
-extern char prognm[];
-extern char psfnm[];
-extern char lognm[];
-extern float deltar, deltaxy, deltaxy_nyq;
 extern void Sum4N4NToNN(float *sorc, float *desti, int Ndim, int osmp);
 
 extern void WritePlane(int plane, float *outvol, float *inslice, int w, int h, int inx, int iny);
@@ -46,25 +43,28 @@ extern void ZeroOut(float *f, int siz);
 extern void Save2D(float *datt, int NN, char *ffname);
 extern void ScaleVol(float *f,int siz, float fsc);
 
-void rdlinesum(float *outpsf, osm_ds *head, int bin, 
+int rdlinesum(const xcosm_ctx *ctx, float *outpsf, osm_ds *head, int bin, 
 		float distance, float size, int tandem)
 {
 int	Nxy,Nz,Nr;
 int	ovrsmp;
 int	symmetric;
+int	status = XCOSM_OK;
 FILE 	*fpp,*logfp,*infofp;
 
 float   *psfxz;
-float 	*psf;		/* One (xy) plane of the illumination PSF              */
-float 	*psfbin1, *psfbin; /* One plane of the final and of the condenser PSF  */
-float 	*psfcond;		
+float 	*psf = NULL;	/* One (xy) plane of the illumination PSF              */
+float 	*psfbin1 = NULL, *psfbin = NULL; /* One plane of the final and of the condenser PSF  */
+float 	*psfcond = NULL;		
 float 	illum; 		/* One sample of the illumination patern               */
-float 	*lsf; 		/* Line spread Function                                */
+float 	*lsf = NULL; 	/* Line spread Function                                */
 fcomplex *Clsf;
-float 	*slit; 		/* Slit function                                       */
+float 	*slit = NULL; 	/* Slit function                                       */
 fcomplex *Cslit;
+fftwf_plan plan = NULL,	/* Transforms of the slit and of the lsf               */
+	fwdplan = NULL, invplan = NULL;
 float 	peak; 		/* to normalize                                        */
-float 	*work; 		/*  Working storage                                    */
+float 	*work = NULL; 	/*  Working storage                                    */
 float 	*radpsf; 	/*  PSF intensity image crossection PSF (x, 0, z)      */
 int 	iz, ir, ix, 	/* indices for depth, radial distance,                 */
 	iy, jx, jy; 	/* and the two lateral coordinates                     */
@@ -83,6 +83,8 @@ int 	Nlsf; 		/* Number of samples in the line spread before interp  */
 int 	Mlsf;
 float 	nrm_deltar, 	/* normalized radial or lateral sampling rate          */
 	nrm_deltaxy=1.0;
+/*   real radial and lateral sampling rates (mm) */
+float           deltar, deltaxy, deltaxy_nyq;
 /*   new lateral sampling rate based on oversampling */
 float           deltaxy1;
 float 	weight; 	/* Weigth factor for apodization                       */
@@ -106,6 +108,9 @@ psfxz     = (float*)head->data;
 ovrsmp    = head->xstart;
 Nxy       = head->ystart;
 symmetric = head->zstart;
+deltar      = ctx->deltar;
+deltaxy     = ctx->deltaxy;
+deltaxy_nyq = ctx->deltaxy_nyq;
 /*
 nrm_deltar    = head->xlength;
 nrm_deltaxy   = head->ylength;
@@ -163,8 +168,8 @@ if (symmetric) Zup = (Nz/2) + 1;
 
 /*   ..Make sure that the log file exists */
 
-if((logfp=fopen(lognm,"a"))==(FILE *)NULL) {
-   fprintf(stderr,"rdlinesum: WARNING: can't open logfile %s for write.\n",lognm);
+if((logfp=fopen(ctx->lognm,"a"))==(FILE *)NULL) {
+   fprintf(stderr,"rdlinesum: WARNING: can't open logfile %s for write.\n",ctx->lognm);
    logfp = stderr;
    }
 fprintf(logfp," rdlinesum;\n");
@@ -179,11 +184,11 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n",
   symmetric ? " ":"NOT");
 
 /*   ..write info file for PSF */
-   sprintf(temp_string,"%s.info",psfnm);
+   sprintf(temp_string,"%s.info",ctx->psfnm);
    if((infofp=fopen(temp_string,"a"))==(FILE *)NULL) 
       fprintf(stderr,"can't open file %s for write.\n",temp_string);
    else {
-      sprintf(temp_string,"new psf file: %s",psfnm);
+      sprintf(temp_string,"new psf file: %s",ctx->psfnm);
       keeplog (infofp, temp_string);
       fprintf(infofp,"        Number of slices or planes: %d\n", Nz);
       fprintf(infofp,"Number of xy-samples after binning: %d\n", Nxy);
@@ -198,16 +203,17 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n",
       }
 
 
-fprintf(stderr,"rdlinesum; heck file %s for progress report.\n",lognm);
+fprintf(stderr,"rdlinesum; heck file %s for progress report.\n",ctx->lognm);
      
-/*  Calculate smallest power of two grater than or equal to 2*Nlsf */
-ix = intlog2(2*Nlsf-1); 
-Mlsf=(int)(pow(2.0,(double)(ix+1)));
+/*  Calculate the least size FFTW transforms quickly that is greater
+    than or equal to 2*Nlsf-1 */
+Mlsf = fftsize(2*Nlsf-1);
 
 /* allocate memory for slit array */
 if((slit=(float *)calloc(sizeof(float),(Mlsf+2)))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
 }
 ZeroOut(slit,Mlsf+2);
 
@@ -223,7 +229,12 @@ for(ix=1;ix<=( (int)(size/2.0) );ix++){
 if ( ((int)size)%2 == 0) *(slit+Mlsf- (int)(size/2.0)) = 0.0;
 
 /* Fourier transform the slit function */
-real_fft3d(slit, Mlsf,1,1,Mlsf+2,1,FORWARD);
+if((plan=plan_rfft2d(Mlsf,1,slit))==(fftwf_plan)NULL){
+   fprintf(stderr,"rdlinesum; can't plan FFT\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
+   }
+fftwf_execute(plan);
 ScaleVol(slit,Mlsf+2,(float)Mlsf);
 
 Cslit = (fcomplex *)slit;
@@ -243,42 +254,57 @@ instead of Mlsf+2 elements for the real array slit. */
    before entering iz loop 
 */
 if((work=(float *)calloc(sizeof(float),Nlsf))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(work,Nlsf);
 
-if((radpsf=(float *)calloc(sizeof(float),Nr))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
-   }
-ZeroOut(radpsf,Nr);
-
 if((lsf=(float *)calloc(sizeof(float),(Mlsf+2)))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(lsf,Mlsf+2);
 Clsf = (fcomplex *)lsf;
 
+/* plan the transforms of the lsf once for all planes */
+fwdplan = plan_rfft2d(Mlsf,1,lsf);
+invplan = plan_irfft2d(Mlsf,1,lsf);
+if((fwdplan==(fftwf_plan)NULL)||(invplan==(fftwf_plan)NULL)){
+   fprintf(stderr,"rdlinesum; can't plan FFT\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
+   }
+
 if((psfcond=(float *)calloc(sizeof(float),Mxy*Mxy))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfcond,Mxy*Mxy);
  
 if((psf=(float *)calloc(sizeof(float),Mxy))==(float *)NULL){
-   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psf,Mxy);
 
 if((psfbin=(float *)calloc(sizeof(float),Nxy*Nxy))==(float *)NULL){
-   fprintf(stderr, "rdlinesum; out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr, "rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfbin,Nxy*Nxy);
 
+/* allocate memory for psfbin1. Notice size of array */
+if((psfbin1=(float *)calloc(sizeof(float),Lxy*Lxy))==(float *)NULL){
+   fprintf(stderr,"rdlinesum; out of memory\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
+   }
+
 for(iz=1;iz<=Zup;iz++){
    sprintf(temp_string,"iz = %d",iz);
    keeplog(logfp, temp_string);
@@ -324,16 +350,13 @@ for(iz=1;iz<=Zup;iz++){
       *(lsf+Mlsf-ix+1) = *(lsf+ix-1);
    }
 
-   real_fft3d(lsf,Mlsf,1,1,Mlsf+2,1,FORWARD);
-   printf("real_fft3d\n");
+   fftwf_execute(fwdplan);
    ScaleVol(lsf,Mlsf+2,(float)Mlsf);
 
    mult3dcm(Clsf,Cslit,Mlsf/2+1);
    printf("multi3dcm\n");
-   real_fft3d(lsf,Mlsf,1,1,Mlsf+2,1,REVERSE);
-   for(ix=0;ix<Mlsf+2;ix++) {
-	*(lsf+ix) *= (float)Mlsf;
-   }
+   /* not normalized, this is the scaling by Mlsf the lsf needs */
+   fftwf_execute(invplan);
 
    printf("rdlinesum: deltar: %g, deltaxy1: %g \n", deltar, deltaxy1);
 
@@ -417,13 +440,6 @@ for(iz=1;iz<=Zup;iz++){
       }
    }
 
-   /* allocate memory for psfbin1. Notice size of array */
-	if((psfbin1=(float *)calloc(sizeof(float),Lxy*Lxy))==(float *)NULL)
-	{
-	   fprintf(stderr,"rdlinesum; out of memory in %s\n",prognm);
-	   exit(1);
-	 }
-
     /* sum neighboring pixels to downsample the BIG PSF */
     /* note dimension goes from Mxy to Lxy = Nxy*bin */
 
@@ -468,15 +484,18 @@ for(iz=1;iz<=Zup;iz++){
 /* calculate and save line spread function if desired */
 
 keeplog (logfp, "DONE");
-if(logfp != stderr) fclose(logfp);
 
-/*
-free(radpsf);
+done:
+if(logfp != stderr) fclose(logfp);
+destroy_fft_plan(plan);
+destroy_fft_plan(fwdplan);
+destroy_fft_plan(invplan);
 free(lsf);
+free(psfbin1);
 free(psfbin);
 free(psfcond);
 free(psf);
 free(work);
 free(slit);
-*/
+return(status);
 }
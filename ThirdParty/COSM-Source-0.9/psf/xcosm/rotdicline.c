@@ -32,22 +32,15 @@ rotdicline.c
 #endif
 #include <math.h>
 #include "washu.h"
+#include "xcosm.h"
  
 
-extern char lognm[];
-
-char tmpstring[255];
-
-extern void fftn(float *r, float *i, unsigned nn[], int ndim, int isign);
-
 #define PI      3.1415926535
 #define DatOf1D(dat,x)                  *(dat + (x))
 #define DatOf2D(dat,x,y,wid)            *(dat + (x) + (y)*wid)
 
 
 
-int N,N2,N4,Nover2,Nz,Nr;
-
 void MakeSumToOne(float *dat, int dnx, int dny, int dnz)
 {
 float dval,*fptr = dat;
@@ -74,7 +67,7 @@ void ChangeToReal(float *rpart, float *ipart, int x, int y, int wid)
 }
 
 /* Downsize 4N x 4N plane to N x N by taking four corners */
-void Extract4N4NToNNDisplay(float *src)
+void Extract4N4NToNNDisplay(float *src, int N4, int Nover2)
 {
    int x,y;
    float temp;
@@ -116,7 +109,7 @@ void Extract4N4NToNNDisplay(float *src)
 }
 
 /* Downsize 4N x 4N plane to N x N by taking four corners */
-void Extract4N4NToNN(float *src, float *dest)
+void Extract4N4NToNN(float *src, float *dest, int N4, int Nover2)
 {
    int x,y;
    int secondy,secondx;
@@ -157,7 +150,8 @@ void WritePlane2(int plane, float *dout, float *din, int w, int h)
      }
 }
 
-void rotdicline(float *outpsf_re, 
+int rotdicline(const xcosm_ctx *ctx,
+                float *outpsf_re, 
                 float *outpsf_im,
                 osm_ds *head_re, 
 				osm_ds *head_im,
@@ -179,15 +173,16 @@ void rotdicline(float *outpsf_re,
    int ix,iy,ir,iz,ntot;
    int data_nx,data_ny,data_pl;
    int Nzwanted;
-   unsigned nn[2];
+   int N,N2,N4,Nover2,Nz,Nr;
+   int status = XCOSM_OK;
+   fftwf_plan fwdplan = NULL, invplan = NULL;
   
    float fval,deltaxy,deltaxy1,deltar,r_hat,r,x,y;
-   float *curptr,*rowdat,*outimg,*outptr,*fptr,*outimgosamp,*outptrosamp;
-   float *outimg2,*outptr2;
+   float *curptr,*rowdat,*fptr,*outimgosamp,*outptrosamp;
    float *rowdat2;
    float *ptrr,*ptri;
-   float *real4N4N,*imag4N4N;
-   float *realNN,*imagNN;
+   float *real4N4N = NULL,*imag4N4N = NULL;
+   float *realNN = NULL,*imagNN = NULL;
    float interp_val,radval1,radval2,perc1,perc2;
    float interp_val2, temp;
 
@@ -217,20 +212,19 @@ void rotdicline(float *outpsf_re,
    fprintf(stderr,"DeltaX= %f , DeltaPHI= %f ,AmpRatio %f\n", DeltaX,DeltaPhi,AmpRatio);
    fprintf(stderr,"deltaxy= %f (mm), deltaf= %f (1/mm)\n", deltaxy,deltaf);
 
-   if((fplog=fopen(lognm,"w"))==(FILE*)NULL)
+   if((fplog=fopen(ctx->lognm,"w"))==(FILE*)NULL)
+      fprintf(stderr,"WARNING: Can't open '%s' for write/append\n",ctx->lognm);
+   else
    {
-      fprintf(stderr,"ERROR: Can't open '%s' for write/append\n",lognm);
-      exit(1);
+      fprintf(fplog,"Shear along x in image space (mm) : %f\n",DeltaX);
+      fprintf(fplog,"                Phase bias (rads) : %f\n",DeltaPhi);
+      fprintf(fplog,"                  Amplitude ratio : %f\n",AmpRatio);
+      fprintf(fplog,"   Pixel size in image space (mm) : %f\n",deltaxy);
+      fprintf(fplog," Pixel size in freq. space (1/mm) : %f\n",deltaf);
+      fprintf(fplog,"\n");
+      fclose(fplog);
    }
 
-   fprintf(fplog,"Shear along x in image space (mm) : %f\n",DeltaX);
-   fprintf(fplog,"                Phase bias (rads) : %f\n",DeltaPhi);
-   fprintf(fplog,"                  Amplitude ratio : %f\n",AmpRatio);
-   fprintf(fplog,"   Pixel size in image space (mm) : %f\n",deltaxy);
-   fprintf(fplog," Pixel size in freq. space (1/mm) : %f\n",deltaf);
-   fprintf(fplog,"\n");
-   fclose(fplog);
-
    DeltaPhi = DeltaPhi / 2.0;
    DeltaX = DeltaX / 2.0;
    num_pix = (int)(DeltaX / deltaxy + 0.5);
@@ -246,46 +240,45 @@ void rotdicline(float *outpsf_re,
    else
       Nzwanted = Nz/2+1;
 
-   /* Output psf data */
-   if ((outimg=(float*)calloc(sizeof(float),N*N*Nz))==(float*)NULL)
-   {
-      fprintf(stderr,"ERROR: Out of memory (1).\n");
-      exit(1);
-   }
-   if ((outimg2=(float*)calloc(sizeof(float),N*N*Nz))==(float*)NULL)
-   {
-     fprintf(stderr,"ERROR: Out of memory (1).\n");
-     exit(1);
-   }
-
    /* Real part of the 4Nx4N oversampled 2-D plane */
    if((real4N4N=(float*)calloc(sizeof(float),N4*N4))==(float*)NULL)
    {
      fprintf(stderr,"ERROR: Out of memory (2).\n");
-     exit(1);
+     status = XCOSM_NO_MEMORY;
+     goto done;
    }
    if ((imag4N4N=(float*)calloc(sizeof(float),N4*N4))==(float *)NULL)
    {
       fprintf(stderr,"ERROR: Out of memory (3).\n");
-      exit(1);
+      status = XCOSM_NO_MEMORY;
+      goto done;
    }
 
    /* Real part of the NxN 2-D plane */
    if ((realNN=(float*)calloc(sizeof(float),N*N))==(float *)NULL)
    {
      fprintf(stderr,"ERROR: Out of memory (6).\n");
-     exit(1);
+     status = XCOSM_NO_MEMORY;
+     goto done;
    }
 
    /* Imaginary part of the NxN 2-D plane */
    if ((imagNN=(float*)calloc(sizeof(float),N*N))==(float *)NULL)
    {
      fprintf(stderr,"ERROR: Out of memory (7).\n");
-     exit(1);
+     status = XCOSM_NO_MEMORY;
+     goto done;
    }
 
-   outptr = outimg;
-   outptr2 = outimg2;
+   /* Plan the transforms once for all planes */
+   fwdplan = plan_split_fft2d(N4,N4,real4N4N,imag4N4N,FFTW_FORWARD);
+   invplan = plan_split_fft2d(N,N,realNN,imagNN,FFTW_BACKWARD);
+   if((fwdplan==(fftwf_plan)NULL)||(invplan==(fftwf_plan)NULL))
+   {
+     fprintf(stderr,"ERROR: Can't plan FFT.\n");
+     status = XCOSM_NO_MEMORY;
+     goto done;
+   }
 
    for(iz=0;iz<Nzwanted;iz++)
  {
@@ -341,20 +334,18 @@ void rotdicline(float *outpsf_re,
 
 
  /* Now take 2D forward DFT of 4Nx4N array calculated above */
-/* forward here means using exp(-j...) and that's why I use -1 in the call
-which is really the reverse for the definition of this fft routine */
- nn[0] = N4; nn[1] = N4;
- fftn(real4N4N,imag4N4N,nn,2,-1);
+/* forward here means using exp(-j...) */
+ fftwf_execute(fwdplan);
 
  /*  
    Now, downsample in X/Y direction by 1/4th
    removing unwanted frequencies > 1/(2deltax) 
  */
 
- //Extract4N4NToNNDisplay(real4N4N);
+ //Extract4N4NToNNDisplay(real4N4N,N4,Nover2);
 
- Extract4N4NToNN(real4N4N,realNN);
- Extract4N4NToNN(imag4N4N,imagNN);
+ Extract4N4NToNN(real4N4N,realNN,N4,Nover2);
+ Extract4N4NToNN(imag4N4N,imagNN,N4,Nover2);
 
 /* ChangeToReal(realNN,imagNN,Nover2,Nover2,N); */
 printf("twoPInum_pix=%f, DeltaPhi=%f",twoPInum_pix,DeltaPhi);
@@ -407,16 +398,16 @@ if (ratfactor == 0.0) {
     }
 
  /* Take inverse transform to get plane of the PSF */
- nn[0] = N; nn[1] = N;
- fftn(realNN,imagNN,nn,2,1);
+ fftwf_execute(invplan);
 
-/*Scale by a factor of 4x4=16 to accomodate for the FFT scale factor and the
-   downsampling by a factor of 4 in x and y */
+/*Scale by N*N for the unnormalized inverse FFT and by a factor of 4x4=16
+   to accomodate for the FFT scale factor and the downsampling by a factor
+   of 4 in x and y */
  ptrr = realNN; ptri = imagNN;
  for(ir=0;ir<ntot;ir++)
 	 {
-	  *ptrr++ /= 16.0;
-	  *ptri++ /= 16.0;
+	  *ptrr++ /= 16.0*(float)ntot;
+	  *ptri++ /= 16.0*(float)ntot;
 	  }
 
  /* Copy to 3-D PSF */
@@ -463,6 +454,13 @@ write_dataset(head,tmpstring);
 
 */ 
 
-
+done:
+destroy_fft_plan(fwdplan);
+destroy_fft_plan(invplan);
+free(real4N4N);
+free(imag4N4N);
+free(realNN);
+free(imagNN);
+return(status);
 }
 
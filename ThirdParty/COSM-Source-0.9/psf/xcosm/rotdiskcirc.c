@@ -27,19 +27,11 @@ support desired for hp(x,y,z)
 
 #include "misc.h"
 #include "washu.h"
+#include "xcosm.h"
 
 
-extern char prognm[];
-extern char psfnm[];
-extern char lognm[];
 extern void WritePlane(int plane, float *outvol, float *inslice, int w, int h, int inx, int iny);
 extern void ZeroOut(float *f,int siz);
-extern void r2xy(float *fxy, float *fr, int Nnx, int Nny, int Nnr, float
-ratio);
-extern float deltar; /* real deltar value from calling routine */
-
-/* global parameters */
-double  *bcf, *ccf, *dcf, *dr_cord; /* arraies for cubic spline inter. */
 
 
 /*****************************************************************************
@@ -48,9 +40,11 @@ name: spline_r2xy
 This routine uses the cubic spline interpolation to interpolate the
 PSF values that are needed when sweping a radial section to a plane of the
 PSF. This routine works like r2xy (in misc.c) but using cubic interpolation
-instead of linear interpolation.
+instead of linear interpolation. dr_cord holds the radial coordinates of
+fr, bcf, ccf and dcf receive the spline coefficients (Nnr each).
 ******************************************************************************/
-void spline_r2xy(float *fxy, float *fr, int Nnx, int Nny, int Nnr, float deltaxy, float deltar)
+void spline_r2xy(float *fxy, float *fr, int Nnx, int Nny, int Nnr, float deltaxy, float deltar,
+		double *dr_cord, double *bcf, double *ccf, double *dcf)
 {
 extern void evenrepr(float *array, int Nnx, int Nny);
 int	iy, ix, ir;
@@ -94,20 +88,23 @@ for(iy=1;iy<=HalfNny+1;iy++){
 evenrepr(fxy, Nnx, Nny);
 }
 
-void rotdiskcirc(float *outpsf, osm_ds *head, int bin,
+int rotdiskcirc(const xcosm_ctx *ctx, float *outpsf, osm_ds *head, int bin,
 		float distance, float size, int tandem)
 {
 int 		Nxy,Nz,Nr;
 int		ovrsmp;
 int		symmetric;
+int		status = XCOSM_OK;
 FILE		*logfp,*infofp;
 
-float		*pupil; 	/*   Pupil function and its Fourier transform */
+float		*pupil = NULL; 	/*   Pupil function and its Fourier transform */
 fcomplex	*Cpupil;
-float		*psfobj; 	/*   One (xy) plane of the objective's PSF    */
-float		*psfbin; 	/*   One plane (xy) of the final PSF          */
-float		*psfcond; 	/*   One plane of the condenser PSF           */
+float		*psfobj = NULL; /*   One (xy) plane of the objective's PSF    */
+float		*psfbin = NULL; /*   One plane (xy) of the final PSF          */
+float		*psfcond = NULL; /*   One plane of the condenser PSF           */
 fcomplex	*otfcond;
+fftwf_plan	plan = NULL, 	/*   Transforms of the pupil and of psfcond   */
+		fwdplan = NULL, invplan = NULL;
 float		peak;		/*   Max. value of arrays (normalization)     */
 float		illum; 		/*   One sample of the illumination patern    */
 float		tmp;
@@ -117,6 +114,7 @@ float		*psfxz;
 float		Vxx, Vyx, 	/*   Elements of the sampling matrix          */
 		Vxy, Vyy; 
 double  cord, sq_cord;
+double  *bcf = NULL, *ccf = NULL, *dcf = NULL, *dr_cord = NULL; /* arraies for cubic spline inter. */
 float interp_val;
 
 int		iz, ir, ix, 	/*   indices for depth, radial distance,      */
@@ -143,6 +141,8 @@ int		Mxy, Halfway;
 int		Pxy;
 /*   radial or lateral sampling rate */
 float		nrm_deltar, nrm_deltaxy=1.0, deltaxy1;
+/*   real radial sampling (mm) */
+float		deltar;
 /*   Floating point version of the above */
 float		ratio;
 /*   Weigth factors for apodization */
@@ -178,6 +178,7 @@ psfxz     = (float*)head->data;
 ovrsmp    = head->xstart;
 Nxy       = head->ystart;
 symmetric = head->zstart;
+deltar    = ctx->deltar;
 /* leave at 1.0
 nrm_deltar    = head->xlength;
 nrm_deltaxy   = head->ylength;
@@ -245,15 +246,13 @@ Maxir = (int) ((Maxrprime + 1.0)/nrm_deltar);
 appod = 1.0;
 if (Maxir > Nr) appod = 1.0/(float)(Maxir - Nr) ;
 
-/*   ..Calculate size of puipl function array */
-Pxy = Nxy*ovrsmp*bin;
-/*   ..Calculate the least power of 2 that will fit */
-Pxy = intlog2(Pxy-1);
-Pxy = (int) pow(2.0 , Pxy+1);
+/*   ..Calculate size of puipl function array, the least size
+	FFTW transforms quickly that will fit */
+Pxy = fftsize(Nxy*ovrsmp*bin);
 
 /*   ..Make sure that the log file exists */
-if((logfp=fopen(lognm,"a"))==(FILE *)NULL) {
-   fprintf(stderr,"WARNING: (rotdiskcirc) can't open logfile `%s' for write.\n",lognm);
+if((logfp=fopen(ctx->lognm,"a"))==(FILE *)NULL) {
+   fprintf(stderr,"WARNING: (rotdiskcirc) can't open logfile `%s' for write.\n",ctx->lognm);
    logfp = stderr;
    }
 fprintf(logfp,"         Number of slices or planes: %d\n", Nz);
@@ -272,7 +271,7 @@ fprintf(logfp,"                                Vyy: %f\n",Vyy);
 fprintf(logfp,"even symmetry in z is %s assumed.\n", symmetric ? "":"NOT");
 
 
-   sprintf(temp_string,"%s.info",psfnm);
+   sprintf(temp_string,"%s.info",ctx->psfnm);
    if((infofp=fopen(temp_string,"a"))==(FILE *)NULL) 
       fprintf(stderr,"WARNING: can't open info file %s for write.\n",temp_string);
    else {
@@ -288,7 +287,7 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n", symmetric ? "":"NOT");
          }
 
 
-fprintf(stderr,"check file %s for progress report.\n",lognm);
+fprintf(stderr,"check file %s for progress report.\n",ctx->lognm);
 
 if (size >= 1.0) {
    keeplog (logfp, "sampling pupil function ");
@@ -296,8 +295,9 @@ if (size >= 1.0) {
    /* first allocate memory for array pupil */
    if((pupil=(float *)calloc(sizeof(float),((Pxy+2)*Pxy)))==
       (float *)NULL) {
-      fprintf(stderr,"out of memory in %s\n",prognm);
-      exit(1);
+      fprintf(stderr,"out of memory in rotdiskcirc\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
       }
    ZeroOut(pupil,(Pxy+2)*Pxy);
 
@@ -306,7 +306,12 @@ if (size >= 1.0) {
    add2columns(pupil,Pxy,Pxy);
 
    /* Fourier transform pupil function */
-   real_fft3d(pupil,Pxy,Pxy,1,Pxy+2,Pxy,FORWARD);
+   if((plan=plan_rfft2d(Pxy,Pxy,pupil))==(fftwf_plan)NULL) {
+      fprintf(stderr,"can't plan FFT in rotdiskcirc\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
+      }
+   fftwf_execute(plan);
    Cpupil=(fcomplex *)pupil;
 
    /* If tandem scanning, the equivalent pinhole function is the
@@ -316,27 +321,46 @@ if (size >= 1.0) {
    /* Normalize Cpupil array to avoid handling very small numbers */
    peak = 0.0;
    norm3dcm (Cpupil, &peak, Pxy*(Pxy+2)/2);
+
+   /* The inverse FFT is not normalized, divide by its scale here
+      once instead of in every plane */
+   peak = (float)Pxy*(float)Pxy;
+   norm3dcm (Cpupil, &peak, Pxy*(Pxy+2)/2);
    }
      
 /* allocate memory for psfobj. Notice size of array   */
 if((psfobj=(float *)calloc(sizeof(float),Mxy*Mxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskcirc\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfobj,Mxy*Mxy);
 
 /* allocate memory for psfcond. Notice size of array   */
 if((psfcond=(float *)calloc(sizeof(float),(Pxy+2)*Pxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskcirc\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfcond,(Pxy+2)*Pxy);
 otfcond=(fcomplex *)psfcond;
 
+/* plan the transforms of psfcond once for all planes */
+if (size >= 1.0) {
+   fwdplan = plan_rfft2d(Pxy,Pxy,psfcond);
+   invplan = plan_irfft2d(Pxy,Pxy,psfcond);
+   if((fwdplan==(fftwf_plan)NULL)||(invplan==(fftwf_plan)NULL)) {
+      fprintf(stderr,"can't plan FFT in rotdiskcirc\n");
+      status = XCOSM_NO_MEMORY;
+      goto done;
+      }
+   }
+
 /* allocate memory for psfbin. Notice size of array   */
 if((psfbin=(float *)calloc(sizeof(float),Nxy*Nxy))==(float *)NULL) {
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskcirc\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfbin,Nxy*Nxy);
 
@@ -344,19 +368,23 @@ ZeroOut(psfbin,Nxy*Nxy);
 /* allocate arrays for the cubic spline interpolation routine (spline.c) */
 if((dr_cord=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((bcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((ccf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((dcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 /* initialize radial coordinates array for the spline call */
@@ -377,18 +405,20 @@ for(iz=1;iz<=Zup;iz++){
    radpsf = (psfxz + (iz-1)*Nr);
 
    /* Calculate the objective PSF (iterpolate rz section into xyz sect)*/
-   spline_r2xy(psfobj, radpsf, Mxy, Mxy, Nr, deltaxy1, deltar); 
+   spline_r2xy(psfobj, radpsf, Mxy, Mxy, Nr, deltaxy1, deltar,
+	       dr_cord, bcf, ccf, dcf); 
 
  if (size >= 1.0) {
       /* Convolve condenser PSF and aperture */
       /* interpolate w/o subsampling i.e. ratio = 1.0*/
-      spline_r2xy(psfcond, radpsf, Pxy, Pxy, Nr, deltar,deltar);
+      spline_r2xy(psfcond, radpsf, Pxy, Pxy, Nr, deltar,deltar,
+		  dr_cord, bcf, ccf, dcf);
       add2columns(psfcond,Pxy,Pxy);
 
       /*  Fourier transform, multiply, inverse Fourier transform */
-      real_fft3d(psfcond,Pxy,Pxy,1,Pxy+2,Pxy,FORWARD);
+      fftwf_execute(fwdplan);
       mult3dcm(otfcond, Cpupil, (Pxy+2)*Pxy/2);
-      real_fft3d(psfcond,Pxy,Pxy,1,Pxy+2,Pxy,REVERSE);
+      fftwf_execute(invplan);
 
       /* Copy first line of convolution to radpsd to use for illumination */
       NetNr = Pxy/2+1;
@@ -512,14 +542,21 @@ for(iz=1;iz<=Zup;iz++){
 
 
 keeplog (logfp, "DONE");
+
+done:
 if(logfp != stderr) fclose(logfp);
-/*
-free(radpsf);
+destroy_fft_plan(plan);
+destroy_fft_plan(fwdplan);
+destroy_fft_plan(invplan);
 free(psfbin);
 free(psfobj);
 free(psfcond);
 free(pupil);
-*/
+free(dr_cord);
+free(bcf);
+free(ccf);
+free(dcf);
+return(status);
 }
 
 
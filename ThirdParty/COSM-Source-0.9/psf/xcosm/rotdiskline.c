@@ -28,16 +28,11 @@ support desired for hp(x,y,z)
 
 #include "misc.h"
 #include "washu.h"
-
-extern char prognm[];
-extern char psfnm[];
-extern char lognm[];
+#include "xcosm.h"
 
 extern void WritePlane(int plane, float *outvol, float *inslice, int w, int h, int inx, int iny);
 extern void ZeroOut(float *f, int siz);
 
-extern float deltar; /* real deltar value from calling routine */
-
 void ScaleVol(float *f,int siz, float fsc)
 {
 int i;
@@ -51,31 +46,34 @@ for(fptr=f,i=0;i<siz;i++,fptr++) {
 
 }
 
-void rotdiskline(float *outpsf, osm_ds *head, int bin, 
+int rotdiskline(const xcosm_ctx *ctx, float *outpsf, osm_ds *head, int bin, 
 		float distance, float size, int tandem)
 {
 int	Nxy,Nz,Nr;
 int	ovrsmp;
 int	symmetric;
+int	status = XCOSM_OK;
 FILE 	*fpp,*logfp,*infofp;
 
 float   *psfxz;
-float 	*psf;		/* One (xy) plane of the illumination PSF              */
-float 	*psfbin; 	/* One plane of the condenser PSF and of the final PSF */
-float 	*psfcond;	
+float 	*psf = NULL;	/* One (xy) plane of the illumination PSF              */
+float 	*psfbin = NULL; /* One plane of the condenser PSF and of the final PSF */
+float 	*psfcond = NULL;	
 float   *slicerow; 	/* 1D array used for cubic spine interpolation */
-double  *bcf, *ccf, *dcf, *dr_cord; /* arraies for cubic spline inter. */
+double  *bcf = NULL, *ccf = NULL, *dcf = NULL, *dr_cord = NULL; /* arraies for cubic spline inter. */
 double  cord, sq_cord;
 int endpoints;
 float interp_val;
 
 float 	illum; 		/* One sample of the illumination patern               */
-float 	*lsf; 		/* Line spread Function                                */
+float 	*lsf = NULL; 	/* Line spread Function                                */
 fcomplex *Clsf;
-float 	*slit; 		/* Slit function                                       */
+float 	*slit = NULL; 	/* Slit function                                       */
 fcomplex *Cslit;
+fftwf_plan plan = NULL,	/* Transforms of the slit and of the lsf               */
+	fwdplan = NULL, invplan = NULL;
 float 	peak; 		/* to normalize                                        */
-float 	*work; 		/*  Working storage                                    */
+float 	*work = NULL; 	/*  Working storage                                    */
 float 	*radpsf; 	/*  PSF intensity image crossection PSF (x, 0, z)      */
 int 	iz, ir, ix, 	/* indices for depth, radial distance,                 */
 	iy, jx, jy; 	/* and the two lateral coordinates                     */
@@ -88,6 +86,7 @@ int 	Nlsf; 		/* Number of samples in the line spread before interp  */
 int 	Mlsf;
 float 	nrm_deltar, 	/* radial or lateral sampling rate                     */
 	deltaxy=1.0, deltaxy1;
+float	deltar;		/* real radial sampling (mm)                           */
 float 	weight; 	/* Weigth factor for apodization                       */
 float 	r, rd, x, y, xsq; 	/* Distances in the detector plane (mm)                */
 float 	xmax;
@@ -106,6 +105,7 @@ psfxz     = (float*)head->data;
 ovrsmp    = head->xstart;
 Nxy       = head->ystart;
 symmetric = head->zstart;
+deltar    = ctx->deltar;
 /*
 nrm_deltar    = head->xlength;
 deltaxy   = head->ylength;
@@ -144,8 +144,8 @@ if (symmetric) Zup = (Nz/2) + 1;
 
 /*   ..Make sure that the log file exists */
 
-if((logfp=fopen(lognm,"a"))==(FILE *)NULL) {
-   fprintf(stderr,"WARNING: can't open logfile %s for write.\n",lognm);
+if((logfp=fopen(ctx->lognm,"a"))==(FILE *)NULL) {
+   fprintf(stderr,"WARNING: can't open logfile %s for write.\n",ctx->lognm);
    logfp = stderr;
    }
 fprintf(logfp,"         Number of slices or planes: %d\n", Nz);
@@ -159,11 +159,11 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n",
   symmetric ? " ":"NOT");
 
 /*   ..write info file for PSF */
-   sprintf(temp_string,"%s.info",psfnm);
+   sprintf(temp_string,"%s.info",ctx->psfnm);
    if((infofp=fopen(temp_string,"a"))==(FILE *)NULL) 
       fprintf(stderr,"can't open file %s for write.\n",temp_string);
    else {
-      sprintf(temp_string,"new psf file: %s",psfnm);
+      sprintf(temp_string,"new psf file: %s",ctx->psfnm);
       keeplog (infofp, temp_string);
       fprintf(infofp,"        Number of slices or planes: %d\n", Nz);
       fprintf(infofp,"Number of xy-samples after binning: %d\n", Nxy);
@@ -178,16 +178,17 @@ fprintf(logfp,"even symmetry in z is %s assumed.\n",
       }
 
 
-fprintf(stderr,"check file %s for progress report.\n",lognm);
+fprintf(stderr,"check file %s for progress report.\n",ctx->lognm);
      
-/*  Calculate smallest power of two grater than or equal to 2*Nlsf */
-ix = intlog2(2*Nlsf-1); 
-Mlsf=(int)(pow(2.0,(double)(ix+1)));
+/*  Calculate the least size FFTW transforms quickly that is greater
+    than or equal to 2*Nlsf-1 */
+Mlsf = fftsize(2*Nlsf-1);
 
 /* allocate memory for slit array */
 if((slit=(float *)calloc(sizeof(float),(Mlsf+2)))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
 }
 ZeroOut(slit,Mlsf+2);
 
@@ -203,7 +204,12 @@ for(ix=1;ix<=( (int)(size/2.0) );ix++){
 if ( ((int)size)%2 == 0) *(slit+Mlsf- (int)(size/2.0)) = 0.0;
 
 /* Fourier transform the slit function */
-real_fft3d(slit, Mlsf,1,1,Mlsf+2,1,FORWARD);
+if((plan=plan_rfft2d(Mlsf,1,slit))==(fftwf_plan)NULL){
+   fprintf(stderr,"can't plan FFT in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
+   }
+fftwf_execute(plan);
 ScaleVol(slit,Mlsf+2,(float)Mlsf);
 Cslit = (fcomplex *)slit;
 peak = 0;
@@ -222,39 +228,47 @@ instead of Mlsf+2 elements for the real array slit. */
    before entering iz loop 
 */
 if((work=(float *)calloc(sizeof(float),Nlsf))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(work,Nlsf);
 
-if((radpsf=(float *)calloc(sizeof(float),Nr))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
-   }
-ZeroOut(radpsf,Nr);
-
 if((lsf=(float *)calloc(sizeof(float),(Mlsf+2)))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(lsf,Mlsf+2);
 Clsf = (fcomplex *)lsf;
 
+/* plan the transforms of the lsf once for all planes */
+fwdplan = plan_rfft2d(Mlsf,1,lsf);
+invplan = plan_irfft2d(Mlsf,1,lsf);
+if((fwdplan==(fftwf_plan)NULL)||(invplan==(fftwf_plan)NULL)){
+   fprintf(stderr,"can't plan FFT in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
+   }
+
 if((psfcond=(float *)calloc(sizeof(float),Mxy*Mxy))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfcond,Mxy*Mxy);
  
 if((psf=(float *)calloc(sizeof(float),Mxy))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psf,Mxy);
 
 if((psfbin=(float *)calloc(sizeof(float),Nxy*Nxy))==(float *)NULL){
-   fprintf(stderr,"out of memory in %s\n",prognm);
-   exit(1);
+   fprintf(stderr,"out of memory in rotdiskline\n");
+   status = XCOSM_NO_MEMORY;
+   goto done;
    }
 ZeroOut(psfbin,Nxy*Nxy);
 
@@ -263,19 +277,23 @@ ZeroOut(psfbin,Nxy*Nxy);
 
 if((dr_cord=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((bcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((ccf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((dcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 slicerow = (float*) psfxz;
@@ -327,13 +345,13 @@ for(iz=1;iz<=Zup;iz++){
    for(ix=2;ix<=Nlsf;ix++)
       *(lsf+Mlsf-ix+1) = *(lsf+ix-1);
 
-   real_fft3d(lsf,Mlsf,1,1,Mlsf+2,1,FORWARD);
+   fftwf_execute(fwdplan);
    ScaleVol(lsf,Mlsf+2,(float)Mlsf);
 
    mult3dcm(Clsf,Cslit,Mlsf/2+1);
 
-   real_fft3d(lsf,Mlsf,1,1,Mlsf+2,1,REVERSE);
-   for(ix=0;ix<Mlsf+2;ix++) *(lsf+ix) *= (float)Mlsf;
+   /* not normalized, this is the scaling by Mlsf the lsf needs */
+   fftwf_execute(invplan);
 
 
 /* compute the cubic spline interpolation coefficients: bcf, ccf, dcf */
@@ -456,15 +474,21 @@ deltaxy1 = deltar*(float)ovrsmp;
 /* calculate and save line spread function if desired */
 
 keeplog (logfp, "DONE");
-if(logfp != stderr) fclose(logfp);
 
-/*
-free(radpsf);
+done:
+if(logfp != stderr) fclose(logfp);
+destroy_fft_plan(plan);
+destroy_fft_plan(fwdplan);
+destroy_fft_plan(invplan);
 free(lsf);
 free(psfbin);
 free(psfcond);
 free(psf);
 free(work);
 free(slit);
-*/
+free(dr_cord);
+free(bcf);
+free(ccf);
+free(dcf);
+return(status);
 }
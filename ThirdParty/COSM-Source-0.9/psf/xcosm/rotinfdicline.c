@@ -29,8 +29,6 @@
 				set up. The mag=1.0 so dxy is same in object
 				and image space */
 
-int N, Nz;
-
 void rotinfdicline(float *outpsf_re,
                 float * outpsf_im,
                 osm_ds *head_re,
@@ -52,8 +50,9 @@ char ofile[MAXPATHLEN];
 int i,j,xi,eta,index;
 int ix,iy,ir,iz,ntot;
 int data_nx,data_ny,data_pl;
-char tmpstring[MAXPATHLEN], lognm[MAXPATHLEN];
+char tmpstring[MAXPATHLEN];
 unsigned nn[2];
+int N;
 float fval,deltaxy,deltaxy1,deltar,r_hat,r,x,y;
 float *realNN,*imagNN;
 float temp;
@@ -68,7 +67,6 @@ realNN = (float*)head_im->data;
 data_nx = (int)(head_im->nx);
 data_ny = (int)(head_im->ny);
 data_pl = data_nx * data_ny;
-Nz = (int)(head_im->nz); 
 N = data_nx;
 deltaxy = sampling_xy;
 fmax = 1/ deltaxy ;
@@ -83,18 +81,18 @@ delta = 2. / N;
 fprintf(stderr,"deltaxy= %f (mm), deltaf= %f (1/mm)\n", deltaxy,deltaf);
 
 if((fplog=fopen("log.info","w"))==(FILE*)NULL)
+  fprintf(stderr,"WARNING: Can't open 'log.info' for write/append\n");
+else
   {
-  fprintf(stderr,"ERROR: Can't open '%s' for write/append\n",lognm);
-  exit(1);
+  fprintf(fplog,"                 File to save PSF : %s\n",ofile);
+  fprintf(fplog,"Shear along x in image space (mm) : %f\n",DeltaX);
+  fprintf(fplog,"                Phase bias (rads) : %f\n",DeltaPhi);
+  fprintf(fplog,"                  Amplitude ratio : %f\n",AmpRatio);
+  fprintf(fplog,"   Pixel size in image space (mm) : %f\n",deltaxy);
+  fprintf(fplog," Pixel size in freq. space (1/mm) : %f\n",deltaf);
+  fprintf(fplog,"\n");
+  fclose(fplog);
   }
-fprintf(fplog,"                 File to save PSF : %s\n",ofile);
-fprintf(fplog,"Shear along x in image space (mm) : %f\n",DeltaX);
-fprintf(fplog,"                Phase bias (rads) : %f\n",DeltaPhi);
-fprintf(fplog,"                  Amplitude ratio : %f\n",AmpRatio);
-fprintf(fplog,"   Pixel size in image space (mm) : %f\n",deltaxy);
-fprintf(fplog," Pixel size in freq. space (1/mm) : %f\n",deltaf);
-fprintf(fplog,"\n");
-fclose(fplog);
 DeltaPhi = DeltaPhi / 2.0;
 DeltaX = DeltaX / 2.0;
 
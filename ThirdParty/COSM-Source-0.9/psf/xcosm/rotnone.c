@@ -12,12 +12,12 @@
 #endif
 #include "washu.h"
 #include "fft3d.h"
+#include "xcosm.h"
 
 #define DatOf1D(dat,x)                  *(dat + (x))
 #define DatOf2D(dat,x,y,wid)            *(dat + (x) + (y)*wid)
 #define MAXPATHLEN 256
 
-extern char lognm[];
 extern void WritePlane(int plane, float *outvol, float *inslice, int w, int h, int inx ,int iny);
 extern int spline_(int *points, double *coord, float *samples, double *b_coef,
 double *c_coef, double *d_coef);
@@ -34,10 +34,12 @@ double *c_coef, double *d_coef);
 
 	    The resulting psf is centered at 0,0,0.	
 
+	    Returns XCOSM_OK, or XCOSM_NO_MEMORY if an allocation failed.
+
  Author: Keith Doolittle
 	 PSF algorithms developed by Jose-Angel Conchello
 *************************************************************************************/
-void rotnone(float *outimg, osm_ds *head)
+int rotnone(const xcosm_ctx *ctx, float *outimg, osm_ds *head)
 {
 char	time_str[MAXPATHLEN];
 char	temp_str[MAXPATHLEN];
@@ -45,14 +47,15 @@ FILE	*fplog;
 int   	oversmp,symmetric;
 int   	N,NO2,Nxy,Nz,Nr,Nzwanted;
 float 	deltaxy,deltar;
-float 	*psfNN;
+float 	*psfNN = NULL;
 float  *outpsf, *rowdat;
 int   	ix,iy,iz,ir,eta;
 float 	r,x,y,fval;
 float 	interp_val;
 double  cord, sq_cord;
-double  *bcf, *ccf, *dcf, *dr_cord;
+double  *bcf = NULL, *ccf = NULL, *dcf = NULL, *dr_cord = NULL;
 time_t 	clock;
+int	status = XCOSM_OK;
 
 outpsf    = (float*)head->data;		/* XY slice data */
 Nz 	  = head->ny;
@@ -79,26 +82,31 @@ else
 
 if((psfNN=(float*)calloc(sizeof(float),N*N))==(float*)NULL) {
  fprintf(stderr,"rotnone; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 rowdat = (float*) outpsf;
 
 if((dr_cord=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotnone; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((bcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotnone; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((ccf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotnone; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 if((dcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotnone; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 /* initialize radial coordinates array for the spline call */
@@ -149,8 +157,8 @@ spline_(&Nr,dr_cord, rowdat,bcf,ccf,dcf);
  /* Increment row counter to point to next row */
  rowdat += Nr;
 
- if((fplog=fopen(lognm,"a"))==(FILE*)NULL)
-   fprintf(stderr,"rotnone; WARNING: Can't open logfile `%s' for write/append (rotnormal)\n",lognm);
+ if((fplog=fopen(ctx->lognm,"a"))==(FILE*)NULL)
+   fprintf(stderr,"rotnone; WARNING: Can't open logfile `%s' for write/append (rotnormal)\n",ctx->lognm);
  else {
       clock = time(NULL);
       strcpy(time_str,asctime(localtime(&clock)));
@@ -162,5 +170,12 @@ spline_(&Nr,dr_cord, rowdat,bcf,ccf,dcf);
       }
  }
 
+done:
+free(psfNN);
+free(dr_cord);
+free(bcf);
+free(ccf);
+free(dcf);
+return(status);
 }
 
@@ -5,16 +5,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include <sys/types.h>
 #ifndef WIN32
 #include <sys/param.h>
 #include <sys/time.h>
 #endif
 #include "washu.h"
+#include "xcosm.h"
 
-extern float deltaxy;
-extern float deltaxy_nyq;
-extern char lognm[];
 extern void WritePlane(int plane, float *outvol, float *inslice,
                         int w, int h, int inx ,int iny);
 extern int spline_(int *points, double *coord, float *samples, double *b_coef,
@@ -91,26 +90,29 @@ for(j=0;j<N;j++)
 	    and then duplicated.
 	    The resulting psf is centered at 0,0,0.	
 
+	    Returns XCOSM_OK, or XCOSM_NO_MEMORY if an allocation failed.
+
  Author: Keith Doolittle
 *************************************************************************************/
 
-void rotsum(float *outimg, osm_ds *head)
+int rotsum(const xcosm_ctx *ctx, float *outimg, osm_ds *head)
 {
 char	time_str[MAXPATHLEN];
 char	temp_str[MAXPATHLEN];
 FILE	*fplog;
 int   	oversmp,symmetric;
 int   	N,N2,N4,Nxy,Nz,Nr,Nzwanted;
-float 	deltaxy1,deltar;
-float 	*psf4N4N,*psfNN,*outpsf,*rowdat;
+float 	deltaxy,deltaxy1,deltar;
+float 	*psf4N4N = NULL,*psfNN = NULL,*outpsf,*rowdat;
 int   	ix,iy,iz,ir;
 int     osamp;
 float 	r_hat,r,x,y;
 float 	interp_val;
 double  cord, sq_cord;
-double  *bcf, *ccf, *dcf, *dr_cord;
+double  *bcf = NULL, *ccf = NULL, *dcf = NULL, *dr_cord = NULL;
 
 time_t 	clock;
+int	status = XCOSM_OK;
 
 outpsf    = (float*)head->data;		/* XY slice data */
 Nz 	  = head->ny;
@@ -126,7 +128,7 @@ deltaxy   = head->ylength;
 
 /* oversampling rate    */
 /* make it beat nyquist */
-osamp = (int)(deltaxy/deltaxy_nyq) + 1;
+osamp = (int)(deltaxy/ctx->deltaxy_nyq) + 1;
 
 if(osamp < 5) osamp = 5;
 
@@ -138,7 +140,7 @@ deltaxy1 = deltaxy/((float)osamp);
 
 #ifdef DEBUG
 fprintf(stderr,"rotsum; DXY: %.4f DXY_NYQ: %.4f SAMP = %d NEW_DXY: %.4f\n",
-		deltaxy,deltaxy_nyq,osamp,deltaxy1);
+		deltaxy,ctx->deltaxy_nyq,osamp,deltaxy1);
 #endif
 
 N      = Nxy;			
@@ -154,33 +156,39 @@ else
 
 if((psf4N4N=(float*)calloc(sizeof(float),N4*N4))==(float*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (2).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 /* Complex psf slice (N+2)/2 x N 2-D plane */
 
 if((psfNN=(float*)calloc(sizeof(float),N*N))==(float*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
  }
 
 rowdat = (float*)outpsf;
 
 if((dr_cord=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
 }
 if((bcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
 }
 if((ccf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
 }
 if((dcf=(double*)calloc(sizeof(double),Nr))==(double*)NULL) {
  fprintf(stderr,"rotsum; ERROR: Out of memory (6).\n");
- exit(1);
+ status = XCOSM_NO_MEMORY;
+ goto done;
 }
 
 /* initialize radial coordinates array for the spline call */
@@ -251,8 +259,8 @@ if(iz == 0) {
  /* Increment row counter to point to next row */
  rowdat += Nr;
 
- if((fplog=fopen(lognm,"a"))==(FILE*)NULL)
-   fprintf(stderr,"rotsum; WARNING: Can't open logfile `%s' for write/append (rotnormal)\n",lognm);
+ if((fplog=fopen(ctx->lognm,"a"))==(FILE*)NULL)
+   fprintf(stderr,"rotsum; WARNING: Can't open logfile `%s' for write/append (rotnormal)\n",ctx->lognm);
  else {
       clock = time(NULL);
       strcpy(time_str,asctime(localtime(&clock)));
@@ -264,5 +272,13 @@ if(iz == 0) {
       }
  }
 
+done:
+free(psf4N4N);
+free(psfNN);
+free(dr_cord);
+free(bcf);
+free(ccf);
+free(dcf);
+return(status);
 }
 
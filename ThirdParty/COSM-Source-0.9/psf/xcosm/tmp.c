@@ -1,13 +1,3 @@
-#define MAXPATHLEN 256
-
-char lognm[MAXPATHLEN] = "psf_xcosm.log";
-char psfnm[MAXPATHLEN] = "psf_xcosm.wu";
-char prognm[MAXPATHLEN] = "CosmPsf";
-
-float deltar = 0;
-float deltaxy = 0;
-float deltaxy_nyq = 0;
-
 void WritePlane(int plane, float *dout, float *din, int w, int h, int indimx, int indimy)
 {
 int pls,i,j,deltx;
@@ -1,6 +1,9 @@
 /***************************************************************************
   COPYRIGHT 1996 BIOMEDICAL COMPUTER LABORATORY, WASHINGTON UNIVERSITY, MO
 ****************************************************************************/
+#ifndef _WASHU_H
+#define _WASHU_H
+
 #define CheckNull(dat) if(dat == NULL) { \
 	fprintf(stderr,"ERROR: Out of memory.\n"); exit(1); }
 
@@ -159,3 +162,5 @@ extern int tobyte(osm_ds *ds);
 extern int tofloat(osm_ds *ds);
 extern int toushort(osm_ds *ds);
 extern void SwabInt(int *d);
+
+#endif /* _WASHU_H */
@@ -1,23 +1,54 @@
+#ifndef _XCOSM_H
+#define _XCOSM_H
+
 #include "washu.h"
 
+#ifndef MAXPATHLEN
 #define MAXPATHLEN 256
+#endif
+
+/* default names of the progress log and of the PSF the .info file is for */
+#define XCOSM_LOGNM "psf_xcosm.log"
+#define XCOSM_PSFNM "psf_xcosm.wu"
+
+/* values returned by the kernels */
+#define XCOSM_OK		0
+#define XCOSM_NO_MEMORY		1	/* an allocation failed */
+#define XCOSM_BAD_SAMPLING	2	/* radial section too short for the plane */
 
+/* Everything a kernel needs besides its arguments and the header of the
+   XZ cross-section. The kernels only read it and keep no state of their
+   own between calls, so several PSFs can be completed at the same time,
+   each with its own context. */
+typedef struct {
+    float deltar;		/* radial sampling of the cross-section (mm) */
+    float deltaxy;		/* lateral sampling of the PSF (mm) */
+    float deltaxy_nyq;		/* lateral Nyquist sampling (mm) */
+    const char *lognm;		/* progress log, appended to */
+    const char *psfnm;		/* PSF name, <psfnm>.info is appended to */
+} xcosm_ctx;
+
+#ifdef __cplusplus
 extern "C" {
+#endif
 
 // routine to create volume PSF from XZ cross-section (interp) 
-void rotnone(
+int rotnone(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head
 );
 
 // routine to create volume PSF from XZ cross-section (sums nghbr pixels) 
-void rotsum(
+int rotsum(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head
 );
 
 // routine to create volume PSF from XZ cross-section for circular confocal 
-void rotdiskcirc(
+int rotdiskcirc(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head,
     int bin, 
@@ -28,7 +59,8 @@ void rotdiskcirc(
 
 // routine to create volume PSF from XZ cross-section for circular confocal 
 // by summing neighboring pixels for undersampled case 
-void rdcircsum(
+int rdcircsum(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head,
     int bin, 
@@ -38,7 +70,8 @@ void rdcircsum(
 );
 
 //routine to create volume PSF from XZ cross-section for slit confocal 
-void rotdiskline(
+int rotdiskline(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head,
     int bin, 
@@ -61,7 +94,8 @@ void rotinfdicline(
 );
 
 // routine to create volume PSF from XZ created by gibson_xzslice
-void rotdicline(
+int rotdicline(
+    const xcosm_ctx *ctx,
     float *volRe, 
     float *volIm, 
     osm_ds *headRe,
@@ -76,7 +110,8 @@ void rotdicline(
 
 // routine to create volume PSF from XZ cross-section for slit confocal 
 // by summing neighboring pixels for undersampled case 
-void rdlinesum(
+int rdlinesum(
+    const xcosm_ctx *ctx,
     float *vol, 
     osm_ds *head,
     int bin, 
@@ -87,4 +122,8 @@ void rdlinesum(
 
 
 
+#ifdef __cplusplus
 };
+#endif
+
+#endif /* _XCOSM_H */
@@ -72,6 +72,16 @@ private:
  * convolution of a sphere with a ParametricImageSource that generates
  * a convolution kernel.
  *
+ * The kernel is generated on a table that covers the output image
+ * shifted by the bead center, with its bounds rounded outwards to
+ * multiples of KernelTablePadding. The table geometry depends on the
+ * parameters only, so the same parameters always give the same image,
+ * and a bead move that leaves the rounded bounds unchanged reuses the
+ * kernel and the convolver's tables of it and only reruns the
+ * convolution. Changing IntensityShift or IntensityScale only reruns
+ * the rescaling. The kernel is regenerated when its own parameters
+ * change or a table bound moves to another multiple.
+ *
  * \ingroup DataSources Multithreaded
 */
 template < class TOutputImage >
@@ -108,6 +118,8 @@ public:
     ConvolverType;
   typedef typename ConvolverType::Pointer
     ConvolverPointer;
+  typedef typename ConvolverType::ConvolutionMethodType
+    ConvolutionMethodType;
   typedef Functor::ScaleShift< typename TOutputImage::PixelType,
                                typename TOutputImage::PixelType,
                                typename TOutputImage::PixelType > ScaleShiftFunctor;
@@ -153,6 +165,13 @@ public:
   void SetShearY(double shear);
   double GetShearY() const;
 
+  /** Set/get the method used to convolve the bead with the kernel,
+   * see SphereConvolutionFilter::SetConvolutionMethod(). Do not use
+   * AutomaticConvolution when fitting the bead radius, the method may
+   * switch between evaluations. */
+  void SetConvolutionMethod(ConvolutionMethodType method);
+  ConvolutionMethodType GetConvolutionMethod() const;
+
   /** Set/get the background value. */
   itkSetMacro(IntensityShift, double);
   itkGetConstMacro(IntensityShift, double);
@@ -161,13 +180,25 @@ public:
   itkSetMacro(IntensityScale, double);
   itkGetConstMacro(IntensityScale, double);
 
+  /** Set/get the step (in nanometers) to which the bounds of the
+   * kernel table are rounded outwards. A larger step lets the bead
+   * move farther before the kernel is regenerated, at the expense of
+   * a larger table. 500 nm by default. */
+  itkSetMacro(KernelTablePadding, double);
+  itkGetConstMacro(KernelTablePadding, double);
+
   /** Set/get the convolution kernel source. */
   virtual void SetKernelSource( KernelImageSourceType* source );
   itkGetObjectMacro(KernelSource, KernelImageSourceType);
 
+  /** Get the filter that convolves the bead with the kernel. */
+  itkGetObjectMacro(Convolver, ConvolverType);
+
   /** Set/get kernel radial symmetry flag. If this flag is set to
    * true, then only a single slice of the kernel corresponding to a
-   * radial profile of the kernel. */
+   * radial profile of the kernel. The bead-spread function is then
+   * interpolated from a radial table, see
+   * SphereConvolutionFilter::SetUseRadialSampleTable(). */
   itkSetMacro(KernelIsRadiallySymmetric, bool);
   itkGetMacro(KernelIsRadiallySymmetric, bool);
   itkBooleanMacro(KernelIsRadiallySymmetric);
@@ -223,6 +254,8 @@ private:
   ConvolverPointer          m_Convolver;
   RescaleImageFilterPointer m_RescaleFilter;
 
+  double                    m_KernelTablePadding;
+
   typedef SimpleMemberCommand< Self > MemberCommandType;
   typedef typename MemberCommandType::Pointer MemberCommandPointer;
   MemberCommandPointer m_ModifiedEventCommand;
@@ -21,6 +21,9 @@
 
 #include "itkBeadSpreadFunctionImageSource.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 namespace itk
 {
@@ -35,6 +38,8 @@ BeadSpreadFunctionImageSource< TOutputImage >
   m_KernelSource = NULL;
   m_KernelIsRadiallySymmetric = false;
 
+  m_KernelTablePadding = 500.0;
+
   m_Convolver = ConvolverType::New();
 
   // Specify multiple integration samples in x and y but not z.
@@ -42,6 +47,10 @@ BeadSpreadFunctionImageSource< TOutputImage >
   m_Convolver->SetNumberOfIntegrationSamples(voxelSamples);
   m_Convolver->WeightIntegrationByAreaOn();
 
+  // A radially symmetric kernel is convolved with the bead once per
+  // (r, z) pair instead of once per sample.
+  m_Convolver->UseRadialSampleTableOn();
+
   m_RescaleFilter = RescaleImageFilterType::New();
   m_RescaleFilter->SetInput(m_Convolver->GetOutput());
 
@@ -222,6 +231,28 @@ BeadSpreadFunctionImageSource< TOutputImage >
 }
 
 
+template< class TOutputImage >
+void
+BeadSpreadFunctionImageSource< TOutputImage >
+::SetConvolutionMethod(ConvolutionMethodType method)
+{
+  if (method != m_Convolver->GetConvolutionMethod())
+    {
+    m_Convolver->SetConvolutionMethod(method);
+    this->Modified();
+    }
+}
+
+
+template< class TOutputImage >
+typename BeadSpreadFunctionImageSource< TOutputImage >::ConvolutionMethodType
+BeadSpreadFunctionImageSource< TOutputImage >
+::GetConvolutionMethod() const
+{
+  return m_Convolver->GetConvolutionMethod();
+}
+
+
 template< class TOutputImage >
 void
 BeadSpreadFunctionImageSource< TOutputImage >
@@ -496,67 +527,101 @@ void
 BeadSpreadFunctionImageSource< TOutputImage >
 ::GenerateData()
 {
-  // Set the PSF sampling spacing and size parameters, and update.
-  PointType   psfTableOrigin;
-  SizeType    psfTableSize;
   SpacingType psfTableSpacing(50.0); // An arbitrary spacing
-
-  // Determine necessary spatial extent of PSF table.
-  PointType minExtent(this->GetOrigin());
-  PointType maxExtent;
   const unsigned int dimensions = itkGetStaticConstMacro(OutputImageDimension);
-  for ( unsigned int i = 0; i < dimensions; i++ )
-    {
-    // First calculate extent of BSF in this dimension.
-    maxExtent[i] = static_cast<PointValueType>
-      (this->GetSize()[i]-1) * this->GetSpacing()[i] + minExtent[i];
 
-    // Now modify calculated PSF dimension to account for bead shift and radius
-    minExtent[i] += -GetBeadCenter()[i] - GetBeadRadius();
-    maxExtent[i] += -GetBeadCenter()[i] + GetBeadRadius();
+  // Determine the extent of the PSF table that the convolution reads,
+  // relative to the bead center. It covers every integration sample of
+  // every voxel after the shear, the bead radius, and below the extra
+  // table z spacing subtracted for the far end of each line.
+  const SizeType    size    = this->GetSize();
+  const SpacingType spacing = this->GetSpacing();
+  const PointType   origin  = this->GetOrigin();
+  const PointType   center  = this->GetBeadCenter();
+  const double      radius  = this->GetBeadRadius();
 
-    // Determine logical extent of the PSF table for the min and max extents.
-    long iDimMin = Math::Floor<long>(minExtent[i] / psfTableSpacing[i]);
-    psfTableOrigin[i] = static_cast<double>(iDimMin) * psfTableSpacing[i];
-    long iDimMax = Math::Ceil<long>(maxExtent[i] / psfTableSpacing[i]);
+  double zMin = origin[2];
+  double zMax = origin[2] + static_cast<double>(size[2]-1) * spacing[2];
+  if (this->GetUseCustomZCoordinates())
+    {
+    zMin = zMax = this->GetZCoordinate(0);
+    for ( unsigned int k = 1; k < size[2]; k++ )
+      {
+      zMin = std::min(zMin, this->GetZCoordinate(k));
+      zMax = std::max(zMax, this->GetZCoordinate(k));
+      }
+    }
+  const double depth = std::max(std::abs(zMin - center[2]), std::abs(zMax - center[2]));
 
-    // Determine the logical extent of the PSF table in this dimension.
-    psfTableSize[i] = iDimMax - iDimMin + 1;
+  PointType minExtent;
+  PointType maxExtent;
+  const double shear[2] = { this->GetShearX(), this->GetShearY() };
+  for ( unsigned int i = 0; i < 2; i++ )
+    {
+    minExtent[i] = origin[i] - 0.5*spacing[i] - center[i] - std::abs(shear[i]) * depth;
+    maxExtent[i] = origin[i] + (static_cast<double>(size[i]) - 0.5) * spacing[i] - center[i] +
+      std::abs(shear[i]) * depth;
+    }
+  minExtent[2] = zMin - 0.5*spacing[2] - center[2] - radius - psfTableSpacing[2];
+  maxExtent[2] = zMax + 0.5*spacing[2] - center[2] + radius;
+
+  // Logical extent of the table, in multiples of the table spacing.
+  long tableMin[ImageDimension];
+  long tableMax[ImageDimension];
+  for ( unsigned int i = 0; i < dimensions; i++ )
+    {
+    tableMin[i] = Math::Floor<long>((i < 2 ? minExtent[i] - radius : minExtent[i]) /
+                                    psfTableSpacing[i]);
+    tableMax[i] = Math::Ceil<long>((i < 2 ? maxExtent[i] + radius : maxExtent[i]) /
+                                   psfTableSpacing[i]);
     }
 
   // Generate just a radial profile of the PSF if it is radially symmetric
   if (this->m_KernelIsRadiallySymmetric)
     {
+    // The distance from the bead axis is largest at one of the corners
+    // of the extent in the xy-plane.
+    double maxRadialDistance = 0.0;
+    for ( unsigned int corner = 0; corner < 4; corner++ )
+      {
+      const double x = (corner & 1) ? maxExtent[0] : minExtent[0];
+      const double y = (corner & 2) ? maxExtent[1] : minExtent[1];
+      maxRadialDistance = std::max(maxRadialDistance, sqrt(x*x + y*y));
+      }
 
-    // Calculate distance from image corners to bead center, projected
-    // to the xy-plane.
-    typedef Point< double, 2> Point2DType;
-    Point2DType beadCenter(GetBeadCenter().GetDataPointer());
-
-    Point2DType pt[4];
-    pt[0][0] = minExtent[0];  pt[0][1] = minExtent[1];
-    pt[1][0] = minExtent[0];  pt[1][1] = maxExtent[1];
-    pt[2][0] = maxExtent[0];  pt[2][1] = minExtent[1];
-    pt[3][0] = maxExtent[0];  pt[3][1] = maxExtent[1];
+    tableMin[0] = 0;
+    tableMax[0] = Math::Ceil<long>((maxRadialDistance + radius) / psfTableSpacing[0]);
+    tableMin[1] = 0;
+    tableMax[1] = 0;
+    }
 
-    double maxRadialDistance = NumericTraits<double>::min();
-    for ( unsigned int i = 0; i < 4; i++)
+  // Round the table bounds outwards to multiples of the padding. The
+  // table then depends on the parameters only, and does not change
+  // while the bead moves within one step.
+  PointType kernelTableOrigin;
+  SizeType  kernelTableSize;
+  for ( unsigned int i = 0; i < dimensions; i++ )
+    {
+    const double step = std::max(1.0, std::ceil(m_KernelTablePadding / psfTableSpacing[i]));
+    const long roundedMin = Math::Floor<long>(tableMin[i] / step) * static_cast<long>(step);
+    const long roundedMax = Math::Ceil<long>(tableMax[i] / step) * static_cast<long>(step);
+    if ( this->m_KernelIsRadiallySymmetric && i < 2 )
       {
-      double distance = pt[i].EuclideanDistanceTo(beadCenter);
-      if (distance > maxRadialDistance) maxRadialDistance = distance;
+      kernelTableOrigin[i] = 0.0;
+      kernelTableSize[i] = i == 0 ? roundedMax + 1 : 1;
+      }
+    else
+      {
+      kernelTableOrigin[i] = static_cast<double>(roundedMin) * psfTableSpacing[i];
+      kernelTableSize[i] = roundedMax - roundedMin + 1;
       }
-
-    // Need to change some values here
-    psfTableOrigin[0] = 0.0;
-    psfTableOrigin[1] = 0.0;
-    long maxRadialSize = Math::Ceil<long>(maxRadialDistance / psfTableSpacing[0]);
-    psfTableSize[0] = maxRadialSize;
-    psfTableSize[1] = 1;
     }
 
-  m_KernelSource->SetSize(psfTableSize);
+  // The kernel source, the convolver and its tables of the kernel are
+  // only updated if they are out of date.
+  m_KernelSource->SetSize(kernelTableSize);
   m_KernelSource->SetSpacing(psfTableSpacing);
-  m_KernelSource->SetOrigin(psfTableOrigin);
+  m_KernelSource->SetOrigin(kernelTableOrigin);
   m_KernelSource->UpdateLargestPossibleRegion();
 
   m_Convolver->SetInput(m_KernelSource->GetOutput());
@@ -599,6 +664,7 @@ BeadSpreadFunctionImageSource< TOutputImage >
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "KernelTablePadding: " << m_KernelTablePadding << std::endl;
   m_KernelSource->Print(os,indent);
   m_Convolver->Print(os,indent);
   m_RescaleFilter->Print(os,indent);
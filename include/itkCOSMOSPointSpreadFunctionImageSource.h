@@ -22,6 +22,11 @@
 #include "itkNumericTraits.h"
 #include "itkParametricImageSource.h"
 
+#include "psf/psfFunctor.h"
+
+#include <string>
+#include <vector>
+
 namespace itk
 {
 
@@ -51,6 +56,15 @@ public:
   typedef typename Superclass::ParametersType      ParametersType;
   typedef typename Superclass::ParametersValueType ParametersValueType;
 
+  /** Type of the COSMOS functor that evaluates the PSF model. */
+  typedef cosm::PsfFunctor< double > FunctorType;
+
+  /** Type of the single-precision COSMOS functor. */
+  typedef cosm::PsfFunctor< float > SinglePrecisionFunctorType;
+
+  /** Quadrature used to evaluate the PSF integral. */
+  typedef FunctorType::Integration IntegrationMethodType;
+
   itkStaticConstMacro(ImageDimension, unsigned int,
                       TOutputImage::ImageDimension);
 
@@ -68,7 +82,8 @@ public:
   itkSetMacro(NumericalAperture, double);
   itkGetConstMacro(NumericalAperture, double);
 
-  /** Set/get the emission wavelength. */
+  /** Set/get the emission wavelength. Ignored when an emission
+   * spectrum is set. */
   itkSetMacro(EmissionWavelength, double);
   itkGetConstMacro(EmissionWavelength, double);
 
@@ -140,6 +155,92 @@ public:
   itkSetMacro(ShearY, double);
   itkGetConstMacro(ShearY, double);
 
+  /** Set/get the quadrature used to evaluate the PSF integral. The
+   * default, FunctorType::INTEGRATION_DQAG, uses the QUADPACK dqag
+   * routine. FunctorType::INTEGRATION_GAUSS_LEGENDRE uses equal
+   * Gauss-Legendre panels, doubling their number until the tolerance
+   * of dqag is met. The number is kept, so the nodes stop changing and
+   * their pupil terms are cached; this is the fastest method.
+   * FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE bisects only the
+   * panels that need it, to the same tolerance. The Gauss-Legendre
+   * methods evaluate the integrand at all nodes of a panel in one
+   * batch. */
+  itkSetMacro(IntegrationMethod, IntegrationMethodType);
+  itkGetConstMacro(IntegrationMethod, IntegrationMethodType);
+
+  /** Set/get the emission spectrum as a list of wavelengths (in
+   * nanometers) and their relative weights. When it is set, the output
+   * is the weighted sum of the PSF intensities at these wavelengths
+   * (see cosm::SpectralPsfFunctor) and EmissionWavelength is ignored.
+   * A single functor is switched between the wavelengths, so the
+   * wavelength-independent pupil terms are computed once. The weights
+   * are normalized to sum to one. Empty (monochromatic) by default. */
+  void SetEmissionSpectrum(const std::vector< double > & wavelengths,
+                           const std::vector< double > & weights);
+  const std::vector< double > & GetEmissionSpectrumWavelengths() const
+  {
+    return m_EmissionSpectrumWavelengths;
+  }
+  const std::vector< double > & GetEmissionSpectrumWeights() const
+  {
+    return m_EmissionSpectrumWeights;
+  }
+
+  /** Set/get whether the PSF model is evaluated in single precision.
+   * The integrand and the quadrature then run in float, which is
+   * roughly 1.5-2 times faster with the Gauss-Legendre methods. The
+   * intensity differs from the double-precision result by a few 1e-6
+   * of the peak deep in the specimen, and by less than 1e-6 near the
+   * coverslip. dqag gains nothing in single precision, so use one of
+   * the Gauss-Legendre methods with it. Off by default. */
+  itkSetMacro(UseSinglePrecision, bool);
+  itkGetConstMacro(UseSinglePrecision, bool);
+  itkBooleanMacro(UseSinglePrecision);
+
+  /** Set/get whether the PSF is evaluated from a piecewise Chebyshev
+   * surrogate (cosm::PsfSurrogate) fitted once over the (z, r) range
+   * of the output image instead of by quadrature at every sample. The
+   * surrogate is kept between updates while the parameters and the
+   * output geometry do not change. If it cannot meet
+   * SurrogateTolerance, a warning is issued and the PSF is evaluated
+   * by quadrature instead. Off by default. */
+  itkSetMacro(UseSurrogate, bool);
+  itkGetConstMacro(UseSurrogate, bool);
+  itkBooleanMacro(UseSurrogate);
+
+  /** Set/get the tolerance of the surrogate, relative to the largest
+   * PSF amplitude over the output image. Default is 1e-4. */
+  itkSetMacro(SurrogateTolerance, double);
+  itkGetConstMacro(SurrogateTolerance, double);
+
+  /** Set/get whether the symmetry of the PSF about the focal plane is
+   * used when the model reports that it is symmetric (matched design
+   * and actual parameters, a point source at zero depth and no
+   * shear). The planes at negative z whose mirror plane is in the
+   * image are then copied from it instead of being computed. The
+   * output is the intensity |PSF|^2, which is the same at z and -z
+   * since PSF(-z, r) is the complex conjugate of PSF(z, r). On by
+   * default. */
+  itkSetMacro(UseZSymmetry, bool);
+  itkGetConstMacro(UseZSymmetry, bool);
+  itkBooleanMacro(UseZSymmetry);
+
+  /** Set/get the directory of the on-disk PSF cache. When set, the
+   * generated image is stored in a file named after a hash of the
+   * parameters, the generation options and the output geometry, and
+   * later updates with the same key (in this or any other process)
+   * read the file instead of recomputing the PSF. Files are written
+   * under a temporary name and renamed into place, so processes can
+   * share the directory. Empty (no cache) by default. */
+  itkSetStringMacro(CacheDirectory);
+  itkGetStringMacro(CacheDirectory);
+
+  /** Set/get the size limit of the cache directory (in megabytes).
+   * After a file is stored, the least recently used files are removed
+   * until the cache fits. Default is 1024. */
+  itkSetMacro(CacheSizeLimit, double);
+  itkGetConstMacro(CacheSizeLimit, double);
+
   /** Expects the parameters argument to contain values for ALL parameters. */
   virtual void SetParameters(const ParametersType& parameters);
 
@@ -149,12 +250,121 @@ public:
   /** Gets the total number of parameters. */
   virtual unsigned int GetNumberOfParameters() const;
 
+  /** Generates the PSF for each of the given point source depths in
+   * the specimen layer, with all the other parameters as set. The
+   * depth enters the optical path difference linearly, so the
+   * functors are kept from one depth to the next and only the
+   * depth-dependent phase is recomputed. The depths are not
+   * evaluated concurrently: each one is a regular threaded Update()
+   * of the whole image, run one after another. The gain over calling
+   * Update() for each depth is the functor reuse only. Memory is
+   * bounded by one functor per thread plus the returned images. The
+   * depth is restored afterwards. */
+  std::vector< typename OutputImageType::Pointer >
+  GenerateDepthStack(const std::vector< double > & depths);
+
 protected:
   COSMOSPointSpreadFunctionImageSource();
   ~COSMOSPointSpreadFunctionImageSource();
 
   void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** Creates a functor that evaluates the PSF model for the current
+   * optical parameters. The caller takes ownership of the functor. */
+  virtual FunctorType * CreateFunctor() const = 0;
+
+  /** Creates a single-precision functor for the current optical
+   * parameters. The caller takes ownership of the functor. */
+  virtual SinglePrecisionFunctorType * CreateSinglePrecisionFunctor() const = 0;
+
+  /** Makes sure there is one functor per thread for the current
+   * optical parameters. The functors are kept between updates and
+   * only rebuilt when the optical parameters or the number of
+   * threads change, or when UseSinglePrecision is toggled. If only
+   * the point source depth changed, the functors are moved to the new
+   * depth instead of being rebuilt. When UseSinglePrecision is on,
+   * the single-precision functors are wrapped so that they can be
+   * used as FunctorType. The integration method is applied to all of
+   * them. Also fits the surrogate if it is used. */
+  virtual void BeforeThreadedGenerateData();
+
+  /** Gets the functor reserved for a thread. Functors are not thread
+   * safe, so a thread must only use its own functor. The surrogate is
+   * read-only once fitted and is shared by all threads. */
+  FunctorType * GetFunctor(ThreadIdType threadId) const
+  {
+    if ( m_UseSurrogate && m_Surrogate )
+      {
+      return m_Surrogate;
+      }
+    return m_FunctorPool[threadId];
+  }
+
+  /** Fits the surrogate over the (z, r) range of the output image
+   * unless the current one already covers it. */
+  void UpdateSurrogate();
+
+  /** Finds the planes that can be copied from their mirror plane. */
+  void UpdateMirroredPlanes();
+
+  /** Returns true if the plane with the given z index is copied from
+   * its mirror plane after the threads finish, in which case
+   * ThreadedGenerateData() need not compute it. */
+  bool IsMirroredPlane(IndexValueType k) const
+  {
+    return !m_MirrorPlanes.empty() && m_MirrorPlanes[k - m_FirstPlane] >= 0;
+  }
+
+  /** Splits the output along z. When planes are mirrored, the split
+   * points are chosen so that every thread gets the same number of
+   * computed planes, since the mirrored planes cost nothing until
+   * AfterThreadedGenerateData(). */
+  virtual unsigned int SplitRequestedRegion(unsigned int i, unsigned int num, OutputImageRegionType & splitRegion);
+
+  /** Copies the mirrored planes. */
+  virtual void AfterThreadedGenerateData();
+
+  /** Reads the output from the cache if it is there, otherwise
+   * generates it and stores it in the cache. */
+  virtual void GenerateData();
+
+  /** Appends everything the output image depends on to the cache
+   * key. Subclasses with options that change the output must append
+   * them as well. */
+  virtual void AppendCacheKey(std::vector< double > & key) const;
+
+  /** Reads the output image from a cache file. Returns false if the
+   * file does not exist or does not match the key. */
+  bool ReadCacheFile(const std::string & fileName, const std::vector< char > & header);
+
+  /** Writes the output image to a cache file and removes the least
+   * recently used files beyond the size limit. */
+  void WriteCacheFile(const std::string & fileName, const std::vector< char > & header);
+
+  /** Gets the parameters the functor depends on, i.e., all the
+   * parameters except the shear, followed by the emission spectrum. */
+  virtual ParametersType GetFunctorParameters() const;
+
+  /** Index of the point source depth in the functor parameters. */
+  itkStaticConstMacro(DepthParameterIndex, unsigned int, 12);
+
+  /** Moves the functors in the pool to the depth in the given functor
+   * parameters. Returns false if the parameters differ in more than
+   * the depth or a functor cannot change its depth. */
+  bool MoveFunctorPoolToDepth(const ParametersType & functorParameters);
+
+  /** Creates a functor for the pool in the requested precision and
+   * for the emission spectrum, if one is set. */
+  FunctorType * CreatePoolFunctor() const;
+
+  /** Wraps a functor in a cosm::SpectralPsfFunctor if an emission
+   * spectrum is set. */
+  template< class TValue >
+  cosm::PsfFunctor< TValue > * ApplyEmissionSpectrum(cosm::PsfFunctor< TValue > * functor) const;
+
+  /** Deletes the functors in the pool. */
+  void ClearFunctorPool();
+
 private:
   COSMOSPointSpreadFunctionImageSource(const COSMOSPointSpreadFunctionImageSource&); // purposely not implemented
   void operator=(const COSMOSPointSpreadFunctionImageSource&); // purposely not implemented
@@ -168,6 +378,10 @@ private:
   // Specified in nanometers
   double m_EmissionWavelength;
 
+  // Wavelengths specified in nanometers, weights are unitless
+  std::vector< double > m_EmissionSpectrumWavelengths;
+  std::vector< double > m_EmissionSpectrumWeights;
+
   // Unitless
   double m_DesignCoverSlipRefractiveIndex;
   double m_ActualCoverSlipRefractiveIndex;
@@ -196,6 +410,42 @@ private:
   // Specified in nanometers in Y vs. nanometers in Z
   double m_ShearY;
 
+  IntegrationMethodType m_IntegrationMethod;
+
+  // One functor per thread, reused between updates
+  std::vector< FunctorType * > m_FunctorPool;
+
+  // Parameters the functors in the pool were created with
+  ParametersType m_FunctorPoolParameters;
+
+  bool m_UseSinglePrecision;
+
+  // Whether the functors in the pool are single-precision
+  bool m_FunctorPoolSinglePrecision;
+
+  bool   m_UseSurrogate;
+  double m_SurrogateTolerance;
+
+  // Surrogate shared by all threads, NULL if the last fit did not
+  // converge
+  FunctorType * m_Surrogate;
+
+  // Parameters, precision, integration method, domain and tolerance the
+  // surrogate was fitted with
+  std::vector< double > m_SurrogateKey;
+
+  bool m_UseZSymmetry;
+
+  // For each plane of the output relative to m_FirstPlane, the plane
+  // it is copied from, or -1 if it is computed
+  std::vector< long > m_MirrorPlanes;
+  IndexValueType      m_FirstPlane;
+
+  std::string m_CacheDirectory;
+
+  // Specified in megabytes
+  double m_CacheSizeLimit;
+
 };
 } // end namespace itk
 
@@ -21,6 +21,34 @@
 
 #include "itkCOSMOSPointSpreadFunctionImageSource.h"
 
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkMath.h"
+
+#include "psf/psfFunctorAdapter.h"
+#include "psf/psfSurrogate.h"
+#include "psf/spectralPsfFunctor.h"
+
+#include "itksys/Directory.hxx"
+#include "itksys/SystemTools.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace itk {
 
 template< class TOutputImage >
@@ -44,12 +72,49 @@ COSMOSPointSpreadFunctionImageSource< TOutputImage >
 
   m_ShearX = 0.0; // nm in X vs. nm in Z
   m_ShearY = 0.0; // nm in Y vs. nm in Z
+
+  m_IntegrationMethod = FunctorType::INTEGRATION_DQAG;
+
+  m_UseSinglePrecision         = false;
+  m_FunctorPoolSinglePrecision = false;
+
+  m_UseSurrogate       = false;
+  m_SurrogateTolerance = 1e-4;
+  m_Surrogate          = NULL;
+
+  m_UseZSymmetry = true;
+  m_FirstPlane   = 0;
+
+  m_CacheSizeLimit = 1024.0; // in megabytes
 }
 
 template< class TOutputImage >
 COSMOSPointSpreadFunctionImageSource< TOutputImage >
 ::~COSMOSPointSpreadFunctionImageSource()
 {
+  this->ClearFunctorPool();
+  delete m_Surrogate;
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::SetEmissionSpectrum(const std::vector< double > & wavelengths,
+                      const std::vector< double > & weights)
+{
+  if ( wavelengths.size() != weights.size() )
+    {
+    itkExceptionMacro(<< "The emission spectrum has " << wavelengths.size()
+                      << " wavelengths but " << weights.size() << " weights");
+    }
+
+  if ( m_EmissionSpectrumWavelengths != wavelengths ||
+       m_EmissionSpectrumWeights != weights )
+    {
+    m_EmissionSpectrumWavelengths = wavelengths;
+    m_EmissionSpectrumWeights     = weights;
+    this->Modified();
+    }
 }
 
 template< class TOutputImage >
@@ -118,6 +183,577 @@ COSMOSPointSpreadFunctionImageSource< TOutputImage >
   return 15;
 }
 
+template< class TOutputImage >
+typename COSMOSPointSpreadFunctionImageSource< TOutputImage >::ParametersType
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::GetFunctorParameters() const
+{
+  // The shear parameters come last and do not affect the functor.
+  ParametersType parameters = this->GetParameters();
+  const unsigned int numberOfParameters = parameters.GetSize() - 2;
+  const unsigned int spectrumSize = m_EmissionSpectrumWavelengths.size();
+  ParametersType functorParameters( numberOfParameters + 2 * spectrumSize );
+  for ( unsigned int i = 0; i < numberOfParameters; i++ )
+    {
+    functorParameters[i] = parameters[i];
+    }
+  for ( unsigned int i = 0; i < spectrumSize; i++ )
+    {
+    functorParameters[numberOfParameters + 2*i]     = m_EmissionSpectrumWavelengths[i];
+    functorParameters[numberOfParameters + 2*i + 1] = m_EmissionSpectrumWeights[i];
+    }
+
+  return functorParameters;
+}
+
+template< class TOutputImage >
+bool
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::MoveFunctorPoolToDepth(const ParametersType & functorParameters)
+{
+  if ( m_FunctorPool.empty() ||
+       m_FunctorPoolParameters.GetSize() != functorParameters.GetSize() )
+    {
+    return false;
+    }
+  for ( unsigned int i = 0; i < functorParameters.GetSize(); i++ )
+    {
+    if ( i != DepthParameterIndex &&
+         m_FunctorPoolParameters[i] != functorParameters[i] )
+      {
+      return false;
+      }
+    }
+
+  // Same units as the functors are created with
+  double depth = 1e-3*functorParameters[DepthParameterIndex];
+  for ( unsigned int i = 0; i < m_FunctorPool.size(); i++ )
+    {
+    if ( !m_FunctorPool[i]->depth( depth ) )
+      {
+      return false;
+      }
+    }
+  m_FunctorPoolParameters = functorParameters;
+
+  return true;
+}
+
+template< class TOutputImage >
+std::vector< typename TOutputImage::Pointer >
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::GenerateDepthStack(const std::vector< double > & depths)
+{
+  double depth = m_ActualPointSourceDepthInSpecimenLayer;
+
+  std::vector< typename OutputImageType::Pointer > stack;
+  stack.reserve( depths.size() );
+  for ( unsigned int i = 0; i < depths.size(); i++ )
+    {
+    this->SetActualPointSourceDepthInSpecimenLayer( depths[i] );
+    this->Update();
+
+    typename OutputImageType::Pointer image = this->GetOutput();
+    image->DisconnectPipeline();
+    stack.push_back( image );
+    }
+
+  this->SetActualPointSourceDepthInSpecimenLayer( depth );
+
+  return stack;
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::BeforeThreadedGenerateData()
+{
+  ParametersType functorParameters = this->GetFunctorParameters();
+  unsigned int numberOfThreads = this->GetNumberOfThreads();
+
+  if ( m_FunctorPool.size() != numberOfThreads ||
+       m_FunctorPoolSinglePrecision != m_UseSinglePrecision ||
+       ( m_FunctorPoolParameters != functorParameters &&
+         !this->MoveFunctorPoolToDepth( functorParameters ) ) )
+    {
+    this->ClearFunctorPool();
+    for ( unsigned int i = 0; i < numberOfThreads; i++ )
+      {
+      m_FunctorPool.push_back( this->CreatePoolFunctor() );
+      }
+    m_FunctorPoolParameters = functorParameters;
+    m_FunctorPoolSinglePrecision = m_UseSinglePrecision;
+    }
+
+  for ( unsigned int i = 0; i < m_FunctorPool.size(); i++ )
+    {
+    m_FunctorPool[i]->integration( m_IntegrationMethod );
+    }
+
+  if ( m_UseSurrogate )
+    {
+    this->UpdateSurrogate();
+    }
+
+  this->UpdateMirroredPlanes();
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::UpdateMirroredPlanes()
+{
+  m_MirrorPlanes.clear();
+
+  OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType region = output->GetLargestPossibleRegion();
+  typename OutputImageType::DirectionType identity;
+  identity.SetIdentity();
+  if ( !m_UseZSymmetry || !this->GetFunctor( 0 )->isSymmetric() ||
+       m_ShearX != 0.0 || m_ShearY != 0.0 ||
+       output->GetDirection() != identity ||
+       output->GetRequestedRegion() != region )
+    {
+    return;
+    }
+
+  // Plane k of the region is at z = origin + (first + k) * spacing, so
+  // its mirror at -z is plane mirrorSum - k, provided that is an
+  // integer.
+  m_FirstPlane = region.GetIndex( 2 );
+  const double mirrorSum = -2.0 * output->GetOrigin()[2] / output->GetSpacing()[2]
+    - 2.0 * m_FirstPlane;
+  const double roundedSum = Math::Round< double >( mirrorSum );
+  if ( std::abs( mirrorSum - roundedSum ) > 1e-6 )
+    {
+    return;
+    }
+
+  const long numberOfPlanes = region.GetSize( 2 );
+  m_MirrorPlanes.assign( numberOfPlanes, -1 );
+  for ( long k = 0; k < numberOfPlanes; ++k )
+    {
+    long mirror = static_cast< long >( roundedSum ) - k;
+    if ( mirror > k && mirror < numberOfPlanes )
+      {
+      m_MirrorPlanes[k] = mirror;
+      }
+    }
+}
+
+template< class TOutputImage >
+unsigned int
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::SplitRequestedRegion(unsigned int i, unsigned int num, OutputImageRegionType & splitRegion)
+{
+  if ( m_MirrorPlanes.empty() )
+    {
+    return Superclass::SplitRequestedRegion( i, num, splitRegion );
+    }
+
+  // Of the n computed planes, piece i starts at i * n / numberOfPieces
+  // and also takes the mirrored planes that follow its last one.
+  std::vector< long > computedPlanes;
+  for ( size_t k = 0; k < m_MirrorPlanes.size(); ++k )
+    {
+    if ( m_MirrorPlanes[k] < 0 )
+      {
+      computedPlanes.push_back( k );
+      }
+    }
+  const unsigned long numberOfComputedPlanes = computedPlanes.size();
+  const unsigned int numberOfPieces = static_cast< unsigned int >(
+    std::min< unsigned long >( num, numberOfComputedPlanes ) );
+
+  splitRegion = this->GetOutput()->GetRequestedRegion();
+  if ( i >= numberOfPieces )
+    {
+    return numberOfPieces;
+    }
+
+  const long first = i == 0 ? 0 :
+    computedPlanes[i * numberOfComputedPlanes / numberOfPieces];
+  const long last = i + 1 == numberOfPieces ?
+    static_cast< long >( m_MirrorPlanes.size() ) - 1 :
+    computedPlanes[(i + 1) * numberOfComputedPlanes / numberOfPieces] - 1;
+  splitRegion.SetIndex( 2, m_FirstPlane + first );
+  splitRegion.SetSize( 2, last - first + 1 );
+
+  itkDebugMacro("  Split Piece: " << splitRegion );
+
+  return numberOfPieces;
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::AfterThreadedGenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  OutputImageRegionType sourcePlane = output->GetLargestPossibleRegion();
+  sourcePlane.SetSize( 2, 1 );
+  OutputImageRegionType targetPlane = sourcePlane;
+
+  for ( size_t k = 0; k < m_MirrorPlanes.size(); ++k )
+    {
+    if ( m_MirrorPlanes[k] < 0 )
+      {
+      continue;
+      }
+    sourcePlane.SetIndex( 2, m_FirstPlane + m_MirrorPlanes[k] );
+    targetPlane.SetIndex( 2, m_FirstPlane + k );
+    ImageRegionConstIterator< OutputImageType > sourceIt( output, sourcePlane );
+    ImageRegionIterator< OutputImageType > targetIt( output, targetPlane );
+    for ( ; !sourceIt.IsAtEnd(); ++sourceIt, ++targetIt )
+      {
+      targetIt.Set( sourceIt.Get() );
+      }
+    }
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::UpdateSurrogate()
+{
+  if ( m_SurrogateTolerance <= 0.0 )
+    {
+    itkExceptionMacro(<< "SurrogateTolerance must be positive, but is "
+                      << m_SurrogateTolerance);
+    }
+
+  // The sample coordinates are computed as in the subclasses. The
+  // distance from the optical axis is convex, so it is largest at one
+  // of the corners of the image.
+  OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType region = output->GetLargestPossibleRegion();
+  double zMin = NumericTraits< double >::max();
+  double zMax = NumericTraits< double >::NonpositiveMin();
+  double rMax = 0.0;
+  for ( unsigned int corner = 0; corner < 8; ++corner )
+    {
+    OutputImageIndexType index = region.GetIndex();
+    for ( unsigned int i = 0; i < 3; ++i )
+      {
+      if ( corner & (1 << i) ) index[i] += region.GetSize( i ) - 1;
+      }
+
+    OutputImagePointType point;
+    output->TransformIndexToPhysicalPoint( index, point );
+
+    // Convert from nanometers to millimeters
+    double pz = point[2] * 1e-6;
+    double px = point[0] * 1e-6 + (pz * this->GetShearX());
+    double py = point[1] * 1e-6 + (pz * this->GetShearY());
+    zMin = std::min( zMin, pz );
+    zMax = std::max( zMax, pz );
+    rMax = std::max( rMax, sqrt( (px*px) + (py*py) ) );
+    }
+
+  ParametersType functorParameters = this->GetFunctorParameters();
+  std::vector< double > key( functorParameters.begin(), functorParameters.end() );
+  key.push_back( m_UseSinglePrecision );
+  key.push_back( m_IntegrationMethod );
+  key.push_back( zMin );
+  key.push_back( zMax );
+  key.push_back( rMax );
+  key.push_back( m_SurrogateTolerance );
+  if ( !m_SurrogateKey.empty() && key == m_SurrogateKey )
+    {
+    return;
+    }
+
+  delete m_Surrogate;
+  m_Surrogate = NULL;
+
+  // A surrogate that misses the tolerance is dropped and the PSF is
+  // evaluated exactly. The key is kept so that it is not refitted
+  // until the parameters or the geometry change.
+  cosm::PsfSurrogate< double > * surrogate =
+    new cosm::PsfSurrogate< double >( *m_FunctorPool[0], zMin, zMax,
+                                      rMax, m_SurrogateTolerance );
+  if ( surrogate->converged() )
+    {
+    m_Surrogate = surrogate;
+    }
+  else
+    {
+    itkWarningMacro(<< "The PSF surrogate did not reach the tolerance "
+                    << m_SurrogateTolerance << " (estimated error "
+                    << surrogate->error() << "), the PSF is evaluated exactly.");
+    delete surrogate;
+    }
+  m_SurrogateKey = key;
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::GenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  if ( m_CacheDirectory.empty() ||
+       output->GetRequestedRegion() != output->GetLargestPossibleRegion() )
+    {
+    Superclass::GenerateData();
+    return;
+    }
+
+  // The file starts with everything the image depends on, so a file
+  // whose header differs is never used even if the hashes collide.
+  std::vector< double > key;
+  this->AppendCacheKey( key );
+
+  std::vector< char > header( 8 );
+  std::memcpy( &header[0], "COSMPSF1", 8 );
+  std::string className( this->GetNameOfClass() );
+  unsigned long long counts[3] = { className.size(), key.size(),
+                                   output->GetLargestPossibleRegion().GetNumberOfPixels() };
+  header.insert( header.end(), className.begin(), className.end() );
+  header.insert( header.end(), reinterpret_cast< const char * >( counts ),
+                 reinterpret_cast< const char * >( counts + 3 ) );
+  if ( !key.empty() )
+    {
+    header.insert( header.end(), reinterpret_cast< const char * >( &key[0] ),
+                   reinterpret_cast< const char * >( &key[0] + key.size() ) );
+    }
+
+  // 64-bit FNV-1a hash of the header
+  unsigned long long hash = 14695981039346656037ULL;
+  for ( size_t i = 0; i < header.size(); i++ )
+    {
+    hash ^= static_cast< unsigned char >( header[i] );
+    hash *= 1099511628211ULL;
+    }
+  std::ostringstream fileName;
+  fileName << m_CacheDirectory << "/" << std::hex;
+  fileName.width( 16 );
+  fileName.fill( '0' );
+  fileName << hash << ".psf";
+
+  this->AllocateOutputs();
+  if ( this->ReadCacheFile( fileName.str(), header ) )
+    {
+    return;
+    }
+
+  Superclass::GenerateData();
+  this->WriteCacheFile( fileName.str(), header );
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::AppendCacheKey(std::vector< double > & key) const
+{
+  ParametersType parameters = this->GetParameters();
+  key.insert( key.end(), parameters.begin(), parameters.end() );
+  key.push_back( m_EmissionSpectrumWavelengths.size() );
+  key.insert( key.end(), m_EmissionSpectrumWavelengths.begin(),
+              m_EmissionSpectrumWavelengths.end() );
+  key.insert( key.end(), m_EmissionSpectrumWeights.begin(),
+              m_EmissionSpectrumWeights.end() );
+  key.push_back( m_UseSinglePrecision );
+  key.push_back( m_IntegrationMethod );
+  key.push_back( m_UseSurrogate );
+  key.push_back( m_UseZSymmetry );
+  key.push_back( m_UseSurrogate ? m_SurrogateTolerance : 0.0 );
+  key.push_back( sizeof( OutputImagePixelType ) );
+  key.push_back( NumericTraits< OutputImagePixelType >::is_integer );
+
+  const OutputImageType * output = this->GetOutput();
+  const OutputImageRegionType region = output->GetLargestPossibleRegion();
+  for ( unsigned int i = 0; i < ImageDimension; ++i )
+    {
+    key.push_back( region.GetIndex( i ) );
+    key.push_back( region.GetSize( i ) );
+    key.push_back( output->GetSpacing()[i] );
+    key.push_back( output->GetOrigin()[i] );
+    for ( unsigned int j = 0; j < ImageDimension; ++j )
+      {
+      key.push_back( output->GetDirection()[i][j] );
+      }
+    }
+}
+
+template< class TOutputImage >
+bool
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::ReadCacheFile(const std::string & fileName, const std::vector< char > & header)
+{
+  OutputImageType * output = this->GetOutput();
+  const size_t dataSize = output->GetLargestPossibleRegion().GetNumberOfPixels()
+    * sizeof( OutputImagePixelType );
+  const size_t fileSize = header.size() + dataSize;
+  char * buffer = reinterpret_cast< char * >( output->GetBufferPointer() );
+
+  bool found = false;
+#ifdef _WIN32
+  std::ifstream file( fileName.c_str(), std::ios::in | std::ios::binary );
+  if ( file && itksys::SystemTools::FileLength( fileName.c_str() ) == fileSize )
+    {
+    std::vector< char > fileHeader( header.size() );
+    file.read( &fileHeader[0], fileHeader.size() );
+    if ( file && fileHeader == header )
+      {
+      file.read( buffer, dataSize );
+      found = !file.fail();
+      }
+    }
+#else
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if ( fd >= 0 )
+    {
+    struct stat status;
+    if ( fstat( fd, &status ) == 0 && static_cast< size_t >( status.st_size ) == fileSize )
+      {
+      void * mapping = mmap( NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0 );
+      if ( mapping != MAP_FAILED )
+        {
+        const char * data = static_cast< const char * >( mapping );
+        if ( std::memcmp( data, &header[0], header.size() ) == 0 )
+          {
+          std::memcpy( buffer, data + header.size(), dataSize );
+          found = true;
+          }
+        munmap( mapping, fileSize );
+        }
+      }
+    close( fd );
+    }
+#endif
+
+  if ( found )
+    {
+    // Mark the file as recently used
+    itksys::SystemTools::Touch( fileName.c_str(), false );
+    }
+  return found;
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::WriteCacheFile(const std::string & fileName, const std::vector< char > & header)
+{
+  if ( !itksys::SystemTools::MakeDirectory( m_CacheDirectory.c_str() ) )
+    {
+    itkWarningMacro(<< "Could not create cache directory " << m_CacheDirectory);
+    return;
+    }
+
+  OutputImageType * output = this->GetOutput();
+  const size_t dataSize = output->GetLargestPossibleRegion().GetNumberOfPixels()
+    * sizeof( OutputImagePixelType );
+
+  // Write under a name unique to this process and object, then rename
+  // so that readers never see a partial file.
+  std::ostringstream tempName;
+#ifdef _WIN32
+  tempName << fileName << ".tmp" << _getpid() << "_" << this;
+#else
+  tempName << fileName << ".tmp" << getpid() << "_" << this;
+#endif
+  {
+  std::ofstream file( tempName.str().c_str(), std::ios::out | std::ios::binary );
+  file.write( &header[0], header.size() );
+  file.write( reinterpret_cast< const char * >( output->GetBufferPointer() ), dataSize );
+  if ( !file )
+    {
+    file.close();
+    std::remove( tempName.str().c_str() );
+    itkWarningMacro(<< "Could not write cache file " << tempName.str());
+    return;
+    }
+  }
+  if ( std::rename( tempName.str().c_str(), fileName.c_str() ) != 0 )
+    {
+    // Another process stored the same image first
+    std::remove( tempName.str().c_str() );
+    }
+
+  // Remove the least recently used files until the cache fits
+  itksys::Directory directory;
+  if ( !directory.Load( m_CacheDirectory.c_str() ) )
+    {
+    return;
+    }
+  std::vector< std::pair< long, std::string > > files;
+  double totalSize = 0.0;
+  for ( unsigned long i = 0; i < directory.GetNumberOfFiles(); ++i )
+    {
+    std::string name( directory.GetFile( i ) );
+    if ( name.size() < 4 || name.compare( name.size() - 4, 4, ".psf" ) != 0 )
+      {
+      continue;
+      }
+    std::string path = m_CacheDirectory + "/" + name;
+    files.push_back( std::make_pair( itksys::SystemTools::ModifiedTime( path.c_str() ), path ) );
+    totalSize += itksys::SystemTools::FileLength( path.c_str() );
+    }
+  std::sort( files.begin(), files.end() );
+  const double limit = m_CacheSizeLimit * 1024.0 * 1024.0;
+  for ( size_t i = 0; i < files.size() && totalSize > limit; ++i )
+    {
+    if ( files[i].second == fileName )
+      {
+      continue;
+      }
+    double size = itksys::SystemTools::FileLength( files[i].second.c_str() );
+    if ( itksys::SystemTools::RemoveFile( files[i].second.c_str() ) )
+      {
+      totalSize -= size;
+      }
+    }
+}
+
+template< class TOutputImage >
+typename COSMOSPointSpreadFunctionImageSource< TOutputImage >::FunctorType *
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::CreatePoolFunctor() const
+{
+  if ( m_UseSinglePrecision )
+    {
+    return new cosm::PsfFunctorAdapter< double, float >(
+      this->ApplyEmissionSpectrum( this->CreateSinglePrecisionFunctor() ) );
+    }
+  return this->ApplyEmissionSpectrum( this->CreateFunctor() );
+}
+
+template< class TOutputImage >
+template< class TValue >
+cosm::PsfFunctor< TValue > *
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::ApplyEmissionSpectrum(cosm::PsfFunctor< TValue > * functor) const
+{
+  if ( m_EmissionSpectrumWavelengths.empty() )
+    {
+    return functor;
+    }
+
+  // Convert from nanometers to millimeters
+  std::vector< TValue > wavelengths( m_EmissionSpectrumWavelengths.size() );
+  std::vector< TValue > weights( m_EmissionSpectrumWeights.size() );
+  for ( unsigned int i = 0; i < wavelengths.size(); i++ )
+    {
+    wavelengths[i] = static_cast< TValue >( 1e-6 * m_EmissionSpectrumWavelengths[i] );
+    weights[i]     = static_cast< TValue >( m_EmissionSpectrumWeights[i] );
+    }
+  return new cosm::SpectralPsfFunctor< TValue >( functor, wavelengths, weights );
+}
+
+template< class TOutputImage >
+void
+COSMOSPointSpreadFunctionImageSource< TOutputImage >
+::ClearFunctorPool()
+{
+  for ( unsigned int i = 0; i < m_FunctorPool.size(); i++ )
+    {
+    delete m_FunctorPool[i];
+    }
+  m_FunctorPool.clear();
+}
+
 template< class TOutputImage >
 void
 COSMOSPointSpreadFunctionImageSource< TOutputImage >
@@ -126,6 +762,12 @@ COSMOSPointSpreadFunctionImageSource< TOutputImage >
   os << indent << "Magnification: " << m_Magnification << "\n";
   os << indent << "NumericalAperture: " << m_NumericalAperture << "\n";
   os << indent << "EmissionWavelength: " << m_EmissionWavelength << "\n";
+  os << indent << "EmissionSpectrum: ";
+  for ( unsigned int i = 0; i < m_EmissionSpectrumWavelengths.size(); i++ )
+    {
+    os << m_EmissionSpectrumWavelengths[i] << " (" << m_EmissionSpectrumWeights[i] << ") ";
+    }
+  os << "\n";
   os << indent << "DesignCoverSlipRefractiveIndex: " << m_DesignCoverSlipRefractiveIndex << "\n";
   os << indent << "ActualCoverSlipRefractiveIndex: " << m_ActualSpecimenLayerRefractiveIndex << "\n";
   os << indent << "DesignCoverSlipThickness: " << m_DesignCoverSlipThickness << "\n";
@@ -138,6 +780,13 @@ COSMOSPointSpreadFunctionImageSource< TOutputImage >
   os << indent << "ActualPointSourceDepthInSpecimenLayer: " << m_ActualPointSourceDepthInSpecimenLayer << "\n";
   os << indent << "ShearX: " << m_ShearX << "\n";
   os << indent << "ShearY: " << m_ShearY << "\n";
+  os << indent << "IntegrationMethod: " << m_IntegrationMethod << "\n";
+  os << indent << "UseSinglePrecision: " << m_UseSinglePrecision << "\n";
+  os << indent << "UseSurrogate: " << m_UseSurrogate << "\n";
+  os << indent << "SurrogateTolerance: " << m_SurrogateTolerance << "\n";
+  os << indent << "UseZSymmetry: " << m_UseZSymmetry << "\n";
+  os << indent << "CacheDirectory: " << m_CacheDirectory << "\n";
+  os << indent << "CacheSizeLimit: " << m_CacheSizeLimit << "\n";
 }
 
 
@@ -73,6 +73,9 @@ public:
   typedef typename Superclass::ParametersType      ParametersType;
   typedef typename Superclass::ParametersValueType ParametersValueType;
 
+  /** Functor type. */
+  typedef typename Superclass::FunctorType FunctorType;
+
   itkStaticConstMacro(ImageDimension, unsigned int,
 		      TOutputImage::ImageDimension);
 
@@ -82,18 +85,48 @@ public:
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
 
+  /** Set/get whether the model is evaluated only once per distinct
+   * (z, r) pair in each z-plane. The values are then copied to every
+   * voxel with that pair, so the output image is identical to the
+   * one computed by evaluating the model at each voxel. On a grid
+   * centered on the optical axis this removes up to 8-fold redundant
+   * work. On by default. */
+  itkSetMacro(DeduplicateRadii, bool);
+  itkGetConstMacro(DeduplicateRadii, bool);
+  itkBooleanMacro(DeduplicateRadii);
+
 protected:
   GibsonLanniCOSMOSPointSpreadFunctionImageSource();
   ~GibsonLanniCOSMOSPointSpreadFunctionImageSource();
 
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Creates the Gibson-Lanni functor for the current optical parameters. */
+  virtual FunctorType * CreateFunctor() const;
+
+  /** Creates the single-precision Gibson-Lanni functor. */
+  virtual SinglePrecisionFunctorType * CreateSinglePrecisionFunctor() const;
+
+  /** Creates the Gibson-Lanni functor in the given precision. */
+  template< class TValue >
+  cosm::PsfFunctor< TValue > * CreatePsfFunctor(TValue absoluteError) const;
+
   /** I made changes to the integrators in cquadpack so that they
    *  could be safely used by multiple threads. */
   void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
                             ThreadIdType threadId);
 
+  /** Fills the region plane by plane, evaluating the functor once
+   * for each distinct (z, r) pair in the plane. */
+  void GenerateDataFromUniqueRadii(const OutputImageRegionType & outputRegionForThread,
+                                   FunctorType & gibsonLanniFunctor);
+
 private:
   GibsonLanniCOSMOSPointSpreadFunctionImageSource(const GibsonLanniCOSMOSPointSpreadFunctionImageSource&); //purposely not implemented
   void operator=(const GibsonLanniCOSMOSPointSpreadFunctionImageSource&); //purposely not implemented
+
+  /** Evaluate the model once per distinct (z, r) pair in a plane. */
+  bool m_DeduplicateRadii;
 };
 } // end namespace itk
 
@@ -27,6 +27,11 @@
 #include "itkObjectFactory.h"
 #include "itkProgressReporter.h"
 
+#include <algorithm>
+#include <complex>
+#include <utility>
+#include <vector>
+
 namespace itk
 {
 
@@ -35,6 +40,7 @@ template< class TOutputImage >
 GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
 ::GibsonLanniCOSMOSPointSpreadFunctionImageSource()
 {
+  m_DeduplicateRadii = true;
 }
 
 
@@ -47,12 +53,31 @@ GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
 
 //----------------------------------------------------------------------------
 template< class TOutputImage >
-void
+typename GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>::FunctorType *
 GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
-::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
-                       ThreadIdType itkNotUsed(threadId))
+::CreateFunctor() const
+{
+  return this->CreatePsfFunctor< double >( 1e-6 );
+}
+
+//----------------------------------------------------------------------------
+template< class TOutputImage >
+typename GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>::SinglePrecisionFunctorType *
+GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::CreateSinglePrecisionFunctor() const
+{
+  // Tighter tolerances cannot be met in single precision
+  return this->CreatePsfFunctor< float >( 1e-5f );
+}
+
+//----------------------------------------------------------------------------
+template< class TOutputImage >
+template< class TValue >
+cosm::PsfFunctor< TValue > *
+GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::CreatePsfFunctor(TValue absoluteError) const
 {
-  cosm::GibsonLaniPsfFunctor< double > gibsonLanniFunctor(
+  return new cosm::GibsonLaniPsfFunctor< TValue >(
     1e-3*this->GetActualPointSourceDepthInSpecimenLayer(),
     1e-3*this->GetDesignImmersionOilThickness(),
     1e-3*this->GetDesignImmersionOilThickness(), // I didn't think this
@@ -69,30 +94,166 @@ GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
     this->GetMagnification(),
     this->GetNumericalAperture(),
     1e-6*this->GetEmissionWavelength(),
-    1e-6);
+    absoluteError);
+}
+
+//----------------------------------------------------------------------------
+template< class TOutputImage >
+void
+GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                       ThreadIdType threadId)
+{
+  FunctorType & gibsonLanniFunctor = *this->GetFunctor( threadId );
 
   OutputImageType * output = this->GetOutput();
 
-  ImageRegionIteratorWithIndex< OutputImageType > it(output, outputRegionForThread);
+  if ( m_DeduplicateRadii )
+    {
+    this->GenerateDataFromUniqueRadii( outputRegionForThread, gibsonLanniFunctor );
+    return;
+    }
+
+  // All voxels of a plane are evaluated as one batch so that the
+  // functor can share its z-dependent terms across them.
+  OutputImageRegionType planeRegion( outputRegionForThread );
+  planeRegion.SetSize( 2, 1 );
+
+  std::vector< double >                 zs;
+  std::vector< double >                 rs;
+  std::vector< std::complex< double > > values;
 
-  while ( !it.IsAtEnd() )
+  const OutputImageSizeValueType numberOfPlanes = outputRegionForThread.GetSize( 2 );
+  for ( OutputImageSizeValueType k = 0; k < numberOfPlanes; ++k )
     {
-    OutputImageIndexType index = it.GetIndex();
-    OutputImagePointType point;
-    output->TransformIndexToPhysicalPoint( index, point );
+    planeRegion.SetIndex( 2, outputRegionForThread.GetIndex( 2 ) + k );
+    if ( this->IsMirroredPlane( planeRegion.GetIndex( 2 ) ) )
+      {
+      continue;
+      }
 
-    // Convert from nanometers to millimeters
-    OutputImagePixelType pz = point[2] * 1e-6;
-    OutputImagePixelType px = point[0] * 1e-6 + (pz * this->GetShearX());
-    OutputImagePixelType py = point[1] * 1e-6 + (pz * this->GetShearY());
+    zs.clear();
+    rs.clear();
+    ImageRegionIteratorWithIndex< OutputImageType > it(output, planeRegion);
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      OutputImageIndexType index = it.GetIndex();
+      OutputImagePointType point;
+      output->TransformIndexToPhysicalPoint( index, point );
 
-    double r = sqrt( (px*px) + (py*py) );
-    it.Set( static_cast< OutputImagePixelType >( norm( gibsonLanniFunctor( pz, r ) ) ) );
+      // Convert from nanometers to millimeters
+      OutputImagePixelType pz = point[2] * 1e-6;
+      OutputImagePixelType px = point[0] * 1e-6 + (pz * this->GetShearX());
+      OutputImagePixelType py = point[1] * 1e-6 + (pz * this->GetShearY());
 
-    ++it;
+      zs.push_back( pz );
+      rs.push_back( sqrt( (px*px) + (py*py) ) );
+      }
+
+    values.resize( zs.size() );
+    gibsonLanniFunctor.evaluate( &zs[0], &rs[0], &values[0], zs.size() );
+
+    size_t sample = 0;
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++sample )
+      {
+      it.Set( static_cast< OutputImagePixelType >( norm( values[sample] ) ) );
+      }
     }
 }
 
+//----------------------------------------------------------------------------
+template< class TOutputImage >
+void
+GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::GenerateDataFromUniqueRadii(const OutputImageRegionType & outputRegionForThread,
+                              FunctorType & gibsonLanniFunctor)
+{
+  typedef std::pair< double, double > SampleType; // (z, r)
+
+  OutputImageType * output = this->GetOutput();
+
+  OutputImageRegionType planeRegion( outputRegionForThread );
+  planeRegion.SetSize( 2, 1 );
+
+  std::vector< SampleType >           samples;
+  std::vector< SampleType >           uniqueSamples;
+  std::vector< OutputImagePixelType > uniqueValues;
+
+  std::vector< double >                 zs;
+  std::vector< double >                 rs;
+  std::vector< std::complex< double > > values;
+
+  const OutputImageSizeValueType numberOfPlanes = outputRegionForThread.GetSize( 2 );
+  for ( OutputImageSizeValueType k = 0; k < numberOfPlanes; ++k )
+    {
+    planeRegion.SetIndex( 2, outputRegionForThread.GetIndex( 2 ) + k );
+    if ( this->IsMirroredPlane( planeRegion.GetIndex( 2 ) ) )
+      {
+      continue;
+      }
+
+    // Compute the sample coordinates exactly as the voxel-by-voxel
+    // evaluation does so that the output is the same.
+    samples.clear();
+    ImageRegionIteratorWithIndex< OutputImageType > it(output, planeRegion);
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      OutputImageIndexType index = it.GetIndex();
+      OutputImagePointType point;
+      output->TransformIndexToPhysicalPoint( index, point );
+
+      // Convert from nanometers to millimeters
+      OutputImagePixelType pz = point[2] * 1e-6;
+      OutputImagePixelType px = point[0] * 1e-6 + (pz * this->GetShearX());
+      OutputImagePixelType py = point[1] * 1e-6 + (pz * this->GetShearY());
+
+      double r = sqrt( (px*px) + (py*py) );
+      samples.push_back( SampleType( pz, r ) );
+      }
+
+    uniqueSamples = samples;
+    std::sort( uniqueSamples.begin(), uniqueSamples.end() );
+    uniqueSamples.erase( std::unique( uniqueSamples.begin(), uniqueSamples.end() ),
+                         uniqueSamples.end() );
+
+    zs.resize( uniqueSamples.size() );
+    rs.resize( uniqueSamples.size() );
+    for ( size_t i = 0; i < uniqueSamples.size(); ++i )
+      {
+      zs[i] = uniqueSamples[i].first;
+      rs[i] = uniqueSamples[i].second;
+      }
+    values.resize( uniqueSamples.size() );
+    gibsonLanniFunctor.evaluate( &zs[0], &rs[0], &values[0], uniqueSamples.size() );
+
+    uniqueValues.resize( uniqueSamples.size() );
+    for ( size_t i = 0; i < uniqueSamples.size(); ++i )
+      {
+      uniqueValues[i] = static_cast< OutputImagePixelType >( norm( values[i] ) );
+      }
+
+    // Scatter the values back to the voxels of the plane.
+    size_t sample = 0;
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++sample )
+      {
+      size_t i = std::lower_bound( uniqueSamples.begin(), uniqueSamples.end(),
+                                   samples[sample] ) - uniqueSamples.begin();
+      it.Set( uniqueValues[i] );
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template< class TOutputImage >
+void
+GibsonLanniCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "DeduplicateRadii: " << m_DeduplicateRadii << "\n";
+}
+
 } // end namespace itk
 
 #endif
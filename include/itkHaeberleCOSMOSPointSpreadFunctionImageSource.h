@@ -73,6 +73,9 @@ public:
   typedef typename Superclass::ParametersType      ParametersType;
   typedef typename Superclass::ParametersValueType ParametersValueType;
 
+  /** Functor type. */
+  typedef typename Superclass::FunctorType FunctorType;
+
   itkStaticConstMacro(ImageDimension, unsigned int,
 		      TOutputImage::ImageDimension);
 
@@ -82,21 +85,67 @@ public:
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
 
+  /** Set/get whether the image is filled by interpolating a radial
+   * profile of the PSF computed once per z-plane instead of
+   * integrating the model at every voxel. The PSF depends only on z
+   * and the distance r from the optical axis, so this reduces the
+   * number of integrations per plane from the number of voxels in the
+   * plane to the number of radial samples. Requires an identity
+   * output direction; with any other direction every voxel is
+   * integrated. Off by default. */
+  itkSetMacro(UseRadialInterpolation, bool);
+  itkGetConstMacro(UseRadialInterpolation, bool);
+  itkBooleanMacro(UseRadialInterpolation);
+
+  /** Set/get the spacing of the radial profile samples (in
+   * nanometers). Smaller values give a more accurate image at the
+   * expense of more integrations per plane. Used only when
+   * UseRadialInterpolation is on. */
+  itkSetMacro(RadialSampleSpacing, double);
+  itkGetConstMacro(RadialSampleSpacing, double);
+
 protected:
   HaeberleCOSMOSPointSpreadFunctionImageSource();
   ~HaeberleCOSMOSPointSpreadFunctionImageSource();
 
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  virtual void BeforeThreadedGenerateData();
+
+  /** Adds the radial interpolation options to the cache key. */
+  virtual void AppendCacheKey(std::vector< double > & key) const;
+
+  /** Creates the Haeberle functor for the current optical parameters. */
+  virtual FunctorType * CreateFunctor() const;
+
+  /** Creates the single-precision Haeberle functor. */
+  virtual SinglePrecisionFunctorType * CreateSinglePrecisionFunctor() const;
+
+  /** Creates the Haeberle functor in the given precision. */
+  template< class TValue >
+  cosm::PsfFunctor< TValue > * CreatePsfFunctor(TValue absoluteError) const;
+
   /** I made changes to the integrators in cquadpack so that they
    *  could be safely used by multiple threads. */
   void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
                             ThreadIdType threadId);
 
+  /** Fills the region plane by plane by linear interpolation in a
+   * radial profile of each plane. Called only when the output image
+   * has an identity direction, so that each plane has a single z
+   * value. */
+  void GenerateDataFromRadialProfiles(const OutputImageRegionType & outputRegionForThread,
+                                      FunctorType & haeberleFunctor);
+
 private:
   HaeberleCOSMOSPointSpreadFunctionImageSource(const HaeberleCOSMOSPointSpreadFunctionImageSource&); //purposely not implemented
   void operator=(const HaeberleCOSMOSPointSpreadFunctionImageSource&); //purposely not implemented
 
-  /** The Haeberle functor that does all the work. */
-  cosm::HaeberlePsfFunctor< double > * m_HaeberleFunctor;
+  /** Fill the image from per-plane radial profiles. */
+  bool m_UseRadialInterpolation;
+
+  // Specified in nanometers
+  double m_RadialSampleSpacing;
 };
 } // end namespace itk
 
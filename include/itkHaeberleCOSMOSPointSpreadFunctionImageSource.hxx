@@ -28,6 +28,8 @@
 #include "itkProgressReporter.h"
 
 #include <algorithm>
+#include <complex>
+#include <vector>
 
 
 namespace itk
@@ -38,6 +40,8 @@ template <class TOutputImage>
 HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
 ::HaeberleCOSMOSPointSpreadFunctionImageSource()
 {
+  m_UseRadialInterpolation = false;
+  m_RadialSampleSpacing    = 10.0; // in nanometers
 }
 
 
@@ -52,10 +56,56 @@ HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
 template < class TOutputImage >
 void
 HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
-::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
-                       ThreadIdType itkNotUsed(threadId))
+::BeforeThreadedGenerateData()
+{
+  Superclass::BeforeThreadedGenerateData();
+
+  if ( m_UseRadialInterpolation && m_RadialSampleSpacing <= 0.0 )
+    {
+    itkExceptionMacro(<< "RadialSampleSpacing must be positive, but is "
+                      << m_RadialSampleSpacing);
+    }
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+void
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::AppendCacheKey(std::vector< double > & key) const
+{
+  Superclass::AppendCacheKey( key );
+
+  key.push_back( m_UseRadialInterpolation );
+  key.push_back( m_UseRadialInterpolation ? m_RadialSampleSpacing : 0.0 );
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+typename HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>::FunctorType *
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::CreateFunctor() const
+{
+  return this->CreatePsfFunctor< double >( 1e-6 );
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+typename HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>::SinglePrecisionFunctorType *
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::CreateSinglePrecisionFunctor() const
 {
-  cosm::HaeberlePsfFunctor< double > haeberleFunctor(
+  // Tighter tolerances cannot be met in single precision
+  return this->CreatePsfFunctor< float >( 1e-5f );
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+template< class TValue >
+cosm::PsfFunctor< TValue > *
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::CreatePsfFunctor(TValue absoluteError) const
+{
+  return new cosm::HaeberlePsfFunctor< TValue >(
     1e-3*this->GetActualPointSourceDepthInSpecimenLayer(),
     1e-3*this->GetDesignImmersionOilThickness(),
     1e-3*this->GetDesignImmersionOilThickness(), // I didn't think this
@@ -72,30 +122,178 @@ HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
     this->GetMagnification(),
     this->GetNumericalAperture(),
     1e-6*this->GetEmissionWavelength(),
-    1e-6);
+    absoluteError);
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+void
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                       ThreadIdType threadId)
+{
+  FunctorType & haeberleFunctor = *this->GetFunctor( threadId );
 
   OutputImageType * output = this->GetOutput();
 
-  ImageRegionIteratorWithIndex< OutputImageType > it(output, outputRegionForThread);
+  // A plane has a single z only when the direction is the identity,
+  // otherwise every voxel is evaluated.
+  typename OutputImageType::DirectionType identity;
+  identity.SetIdentity();
+  if ( m_UseRadialInterpolation && output->GetDirection() == identity )
+    {
+    this->GenerateDataFromRadialProfiles( outputRegionForThread, haeberleFunctor );
+    return;
+    }
+
+  // All voxels of a plane are evaluated as one batch so that the
+  // functor can share its z-dependent terms across them.
+  OutputImageRegionType planeRegion( outputRegionForThread );
+  planeRegion.SetSize( 2, 1 );
 
-  while ( !it.IsAtEnd() )
+  std::vector< double >                 zs;
+  std::vector< double >                 rs;
+  std::vector< std::complex< double > > values;
+
+  const OutputImageSizeValueType numberOfPlanes = outputRegionForThread.GetSize( 2 );
+  for ( OutputImageSizeValueType k = 0; k < numberOfPlanes; ++k )
     {
-    OutputImageIndexType index = it.GetIndex();
-    OutputImagePointType point;
-    output->TransformIndexToPhysicalPoint( index, point );
+    planeRegion.SetIndex( 2, outputRegionForThread.GetIndex( 2 ) + k );
+    if ( this->IsMirroredPlane( planeRegion.GetIndex( 2 ) ) )
+      {
+      continue;
+      }
+
+    zs.clear();
+    rs.clear();
+    ImageRegionIteratorWithIndex< OutputImageType > it(output, planeRegion);
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+      OutputImageIndexType index = it.GetIndex();
+      OutputImagePointType point;
+      output->TransformIndexToPhysicalPoint( index, point );
 
-    // Convert from nanometers to millimeters
-    OutputImagePixelType pz = point[2] * 1e-6;
-    OutputImagePixelType px = point[0] * 1e-6 + (pz * this->GetShearX());
-    OutputImagePixelType py = point[1] * 1e-6 + (pz * this->GetShearY());
+      // Convert from nanometers to millimeters
+      OutputImagePixelType pz = point[2] * 1e-6;
+      OutputImagePixelType px = point[0] * 1e-6 + (pz * this->GetShearX());
+      OutputImagePixelType py = point[1] * 1e-6 + (pz * this->GetShearY());
 
-    double r = sqrt( (px*px) + (py*py) );
-    it.Set( static_cast< OutputImagePixelType >( norm( haeberleFunctor( pz, r ) ) ) );
+      zs.push_back( pz );
+      rs.push_back( sqrt( (px*px) + (py*py) ) );
+      }
 
-    ++it;
+    values.resize( zs.size() );
+    haeberleFunctor.evaluate( &zs[0], &rs[0], &values[0], zs.size() );
+
+    size_t sample = 0;
+    for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++sample )
+      {
+      it.Set( static_cast< OutputImagePixelType >( norm( values[sample] ) ) );
+      }
     }
 }
 
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+void
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::GenerateDataFromRadialProfiles(const OutputImageRegionType & outputRegionForThread,
+                                 FunctorType & haeberleFunctor)
+{
+  OutputImageType * output = this->GetOutput();
+
+  // Convert from nanometers to millimeters
+  const double deltaR = m_RadialSampleSpacing * 1e-6;
+
+  const OutputImageIndexType regionIndex = outputRegionForThread.GetIndex();
+  const OutputImageSizeType  regionSize  = outputRegionForThread.GetSize();
+
+  OutputImageRegionType planeRegion( outputRegionForThread );
+  planeRegion.SetSize( 2, 1 );
+
+  std::vector< double >                 profile;
+  std::vector< double >                 zs;
+  std::vector< double >                 rs;
+  std::vector< std::complex< double > > values;
+
+  for ( OutputImageSizeValueType k = 0; k < regionSize[2]; ++k )
+    {
+    planeRegion.SetIndex( 2, regionIndex[2] + k );
+    if ( this->IsMirroredPlane( planeRegion.GetIndex( 2 ) ) )
+      {
+      continue;
+      }
+
+    // The distance from the optical axis is largest at one of the
+    // corners of the plane.
+    double pz = 0.0;
+    double rMax = 0.0;
+    for ( unsigned int corner = 0; corner < 4; ++corner )
+      {
+      OutputImageIndexType index = planeRegion.GetIndex();
+      if ( corner & 1 ) index[0] += regionSize[0] - 1;
+      if ( corner & 2 ) index[1] += regionSize[1] - 1;
+
+      OutputImagePointType point;
+      output->TransformIndexToPhysicalPoint( index, point );
+
+      pz = point[2] * 1e-6;
+      double px = point[0] * 1e-6 + (pz * this->GetShearX());
+      double py = point[1] * 1e-6 + (pz * this->GetShearY());
+      rMax = std::max( rMax, sqrt( (px*px) + (py*py) ) );
+      }
+
+    // Sample the radial profile of this plane with one sample past
+    // rMax so that every voxel has two neighbors to interpolate between.
+    unsigned int numberOfSamples = Math::Ceil< unsigned int >( rMax / deltaR ) + 2;
+    profile.resize( numberOfSamples );
+    zs.assign( numberOfSamples, pz );
+    rs.resize( numberOfSamples );
+    values.resize( numberOfSamples );
+    for ( unsigned int i = 0; i < numberOfSamples; ++i )
+      {
+      rs[i] = i * deltaR;
+      }
+    haeberleFunctor.evaluate( &zs[0], &rs[0], &values[0], numberOfSamples );
+    for ( unsigned int i = 0; i < numberOfSamples; ++i )
+      {
+      profile[i] = norm( values[i] );
+      }
+
+    ImageRegionIteratorWithIndex< OutputImageType > it(output, planeRegion);
+    while ( !it.IsAtEnd() )
+      {
+      OutputImageIndexType index = it.GetIndex();
+      OutputImagePointType point;
+      output->TransformIndexToPhysicalPoint( index, point );
+
+      // Convert from nanometers to millimeters
+      double px = point[0] * 1e-6 + (pz * this->GetShearX());
+      double py = point[1] * 1e-6 + (pz * this->GetShearY());
+
+      double t = sqrt( (px*px) + (py*py) ) / deltaR;
+      unsigned int i = std::min( static_cast< unsigned int >( t ), numberOfSamples - 2 );
+      double f = t - static_cast< double >( i );
+      double value = (1.0 - f) * profile[i] + f * profile[i+1];
+      it.Set( static_cast< OutputImagePixelType >( value ) );
+
+      ++it;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+template < class TOutputImage >
+void
+HaeberleCOSMOSPointSpreadFunctionImageSource<TOutputImage>
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "UseRadialInterpolation: " << m_UseRadialInterpolation << "\n";
+  os << indent << "RadialSampleSpacing: " << m_RadialSampleSpacing << "\n";
+}
+
 } // end namespace itk
 
 #endif
@@ -20,25 +20,18 @@
 #define __itkSphereConvolutionFilter_h
 
 #include "itkImageToImageFilter.h"
-#include "itkLinearInterpolateImageFunction.h"
 #include "itkScanImageFilter.h"
 #include "itkSumProjectionImageFilter.h"
 
-#include <list>
+#if defined(ITK_USE_FFTWF)
+#include "itkFFTWCommon.h"
+#endif
+
+#include <vector>
 
 namespace itk
 {
 
-/** Struct to hold sphere intersection data. */
-typedef struct SphereIntersection_struct {
-  double x;
-  double y;
-  double z1;
-  double z2;
-  int numIntersections;
-} SphereIntersection;
-
-
 /** \class SphereConvolutionFilter
  *
  * \brief Generate an image of a sphere convolved with the input image.
@@ -53,7 +46,14 @@ typedef struct SphereIntersection_struct {
  * the contribution from that portion of the line to the current image plane
  * can be quickly computed with two lookups and a subtraction. For greater
  * accuracy, the input kernel image should be more finely sampled than
- * the output image.
+ * the output image. The input kernel must have an identity direction.
+ *
+ * For large spheres the filter can instead rasterize the sphere on the
+ * grid of the kernel image, with the partial volume of each voxel, and
+ * convolve it with the kernel by FFT. The output samples are then
+ * trilinearly interpolated from the result. This requires ITK built
+ * with FFTW (ITK_USE_FFTWF) and a 3-D kernel, see
+ * SetConvolutionMethod().
  *
  * \author Cory Quammen. Department of Computer Science, UNC Chapel Hill.
  *
@@ -99,15 +99,17 @@ public:
     ScanImageFilterType;
   typedef typename ScanImageFilterType::Pointer
     ScanImageFilterPointer;
-  typedef LinearInterpolateImageFunction<InputImageType, float>
-    InterpolatorType;
-  typedef typename InterpolatorType::Pointer
-    InterpolatorPointer;
 
-  typedef std::list<SphereIntersection>
+  typedef std::vector<double>
     IntersectionArrayType;
-  typedef typename IntersectionArrayType::const_iterator
-    IntersectionArrayConstIterator;
+
+  /** Methods for computing the convolution of the sphere with the
+   * kernel. */
+  typedef enum {
+    LineIntegralConvolution = 0,
+    FFTConvolution,
+    AutomaticConvolution
+  } ConvolutionMethodType;
 
   itkStaticConstMacro(ImageDimension, unsigned int,
 		      TOutputImage::ImageDimension);
@@ -211,6 +213,45 @@ public:
   itkGetMacro(WeightIntegrationByArea, bool);
   itkBooleanMacro(WeightIntegrationByArea);
 
+  /** Set/get whether a radial input kernel (one slice thick in y) is
+   * convolved with the sphere only once per (r, z) pair. A sample
+   * value then depends only on the sample depth and its distance r
+   * from the sphere axis, so the sum over the vertical lines is
+   * tabulated once per sample depth on a radial grid with half the
+   * kernel x spacing and linearly interpolated in r. The table is
+   * reused until the radius, the sample depths relative to the sphere
+   * center or the kernel change. Ignored for kernels that are not
+   * radial. Off by default. */
+  itkSetMacro(UseRadialSampleTable, bool);
+  itkGetConstMacro(UseRadialSampleTable, bool);
+  itkBooleanMacro(UseRadialSampleTable);
+
+  /** Set/get the convolution method. LineIntegralConvolution sums the
+   * pre-integrated kernel along vertical lines through the sphere for
+   * every sample, its cost grows with the squared sphere radius times
+   * the number of samples. FFTConvolution convolves a rasterized
+   * sphere with the kernel by FFT, its cost depends on the kernel and
+   * sphere extent only. AutomaticConvolution picks the method with the
+   * smaller estimated operation count and uses the FFT only for 3-D
+   * kernels and spheres at least two kernel voxels in radius.
+   *
+   * The methods do not give the same image. The FFT rasterizes the
+   * sphere on the kernel grid with partial volumes and transforms in
+   * single precision, while the line integration adds one kernel z
+   * spacing to every chord. The images typically differ by a few
+   * percent of the peak value, and by much more relative to the
+   * values in the tail.
+   *
+   * AutomaticConvolution re-evaluates the choice on every update, so
+   * the method can switch while the radius, the sample grid or the
+   * kernel change. The image then jumps by the difference between the
+   * methods, which breaks objective functions that vary the bead
+   * radius. Use AutomaticConvolution for single images only and
+   * select a fixed method when fitting. LineIntegralConvolution by
+   * default. */
+  itkSetMacro(ConvolutionMethod, ConvolutionMethodType);
+  itkGetConstMacro(ConvolutionMethod, ConvolutionMethodType);
+
 protected:
   SphereConvolutionFilter();
   ~SphereConvolutionFilter();
@@ -248,14 +289,72 @@ protected:
   SizeType               m_NumberOfIntegrationSamples;
 
   ScanImageFilterPointer m_ScanImageFilter;
-  InterpolatorPointer    m_TableInterpolator;
 
   /* Vertical line sample spacing in X and Y. */
   double m_LineSampleSpacing;
 
-  /** Contains intersection data of a grid of sample points in the
-   * xy-plane. */
-  IntersectionArrayType m_IntersectionArray;
+  /** Intersections of a grid of vertical lines in the xy-plane with
+   * the sphere, relative to the sphere center. Each coordinate has its
+   * own contiguous array and only lines that cross the sphere twice are
+   * kept, the others contribute nothing to the sample values. */
+  IntersectionArrayType m_IntersectionX;
+  IntersectionArrayType m_IntersectionY;
+  IntersectionArrayType m_IntersectionZ1;
+  IntersectionArrayType m_IntersectionZ2;
+
+  /** Sphere radius of the intersection arrays. */
+  double                m_IntersectionRadius;
+
+  /** Invariants of the pre-integrated table, set in
+   * BeforeThreadedGenerateData(). A physical coordinate c maps to the
+   * continuous index c * m_TableInverseSpacing + m_TableIndexOffset.
+   * m_TableStep is the buffer offset to the next sample along each
+   * dimension, or zero if the table is one sample thick there. */
+  bool                       m_TableIsRadial;
+  const InputImagePixelType *m_TableBuffer;
+  double                     m_TableInverseSpacing[ImageDimension];
+  double                     m_TableIndexOffset[ImageDimension];
+  double                     m_TableMaxIndex[ImageDimension];
+  SizeValueType              m_TableMaxBase[ImageDimension];
+  SizeValueType              m_TableStride[ImageDimension];
+  SizeValueType              m_TableStep[ImageDimension];
+
+  /** Radial sample table, one row of m_RadialTableSize values per
+   * sample depth. m_RadialSampleZ holds the depths relative to the
+   * sphere center, z-plane major with the integration samples in z
+   * minor. */
+  bool                m_UseRadialSampleTable;
+  std::vector<double> m_RadialSampleZ;
+  std::vector<double> m_RadialSampleTable;
+  SizeValueType       m_RadialTableSize;
+  double              m_RadialTableSpacing;
+  double              m_RadialTableRadius;
+  unsigned long       m_RadialTableTime;
+
+  /** The requested convolution method and whether the FFT method is
+   * used for the current update. */
+  ConvolutionMethodType m_ConvolutionMethod;
+  bool                  m_UseFFTConvolution;
+
+  /** Result of the FFT convolution, sampled on the kernel grid. The
+   * m_FFTConvolutionSize values of interest are stored with the row
+   * and plane strides of m_FFTSize in m_FFTBuffer. */
+  SizeType              m_FFTSize;
+  SizeType              m_FFTConvolutionSize;
+  InputImagePointType   m_FFTConvolutionOrigin;
+  SpacingType           m_FFTInverseSpacing;
+
+#if defined(ITK_USE_FFTWF)
+  /** FFTW buffers and plans, kept while m_FFTSize does not change. The
+   * kernel spectrum is kept while the kernel does not change either. */
+  float                *m_FFTBuffer;
+  fftwf_complex        *m_FFTSpectrum;
+  fftwf_complex        *m_KernelSpectrum;
+  fftwf_plan            m_ForwardPlan;
+  fftwf_plan            m_InversePlan;
+  SizeType              m_KernelSpectrumSize;
+  unsigned long         m_KernelSpectrumTime;
+#endif
 
   /** Gets the z-coordinate(s) of the intersection of a sphere with a line
    * parallel to the z-axis specified by the x- and y-coordinates. z1 and z2
@@ -273,8 +372,8 @@ protected:
   void ComputeIntersections();
 
   /** Helper method for ComputeIntersections() method. Adds an
-   * intersection to the m_IntersectionArray if an intersection
-   * occurs. */
+   * intersection to the intersection arrays if the line crosses the
+   * sphere twice. */
   void AddIntersection(double xs, double ys);
 
   virtual void BeforeThreadedGenerateData();
@@ -285,9 +384,57 @@ protected:
   /** Computes the light intensity at a specified point. */
   double ComputeSampleValue(OutputImagePointType& point);
 
+  /** Returns whether the continuous index t along dimension d lies in
+   * the pre-integrated table, with the same half-voxel border as
+   * ImageBase::TransformPhysicalPointToContinuousIndex(). */
+  inline bool IsInsideTable(unsigned int d, double t) const
+  {
+    return t >= -0.5 && t < m_TableMaxIndex[d] + 0.5;
+  }
+
+  /** Linearly interpolates the pre-integrated table at a continuous
+   * index, clamped to the table edges like
+   * LinearInterpolateImageFunction. */
+  inline double EvaluateTable(double tx, double ty, double tz) const;
+
+  /** Same as EvaluateTable() for a radial table, which is one sample
+   * thick in y. */
+  inline double EvaluateRadialTable(double tr, double tz) const;
+
   /** Computes the integrated light intensity over multipe samples per voxel.*/
   double ComputeIntegratedVoxelValue(OutputImagePointType& point, const SpacingType& dx);
 
+  /** Fills the radial sample table unless the current one is still
+   * valid. */
+  void ComputeRadialSampleTable();
+
+  /** Fills the rows of the radial sample table assigned to a thread. */
+  void ThreadedComputeRadialSampleTable(ThreadIdType threadId, ThreadIdType numberOfThreads);
+
+  /** Multithreader callback for ThreadedComputeRadialSampleTable(). */
+  static ITK_THREAD_RETURN_TYPE RadialSampleTableThreaderCallback(void *arg);
+
+  /** Same as ComputeIntegratedVoxelValue(), but looks the samples up
+   * in the radial sample table. zIndex is the z index of the voxel. */
+  double ComputeIntegratedRadialVoxelValue(OutputImagePointType& point, const SpacingType& dx,
+                                           SizeValueType zIndex) const;
+
+  /** Decides whether the current update uses the FFT convolution. */
+  bool SelectFFTConvolution() const;
+
+  /** Convolves the rasterized sphere with the input kernel by FFT. */
+  void ComputeFFTConvolution();
+
+  /** Interpolates the FFT convolution at a point. */
+  double ComputeFFTSampleValue(const OutputImagePointType& point) const;
+
+  /** Frees the FFTW buffers and plans. */
+  void ReleaseFFTData();
+
+  /** Returns the smallest size not less than n whose only prime
+   * factors are 2, 3, 5 and 7. */
+  static SizeValueType GetFFTSize(SizeValueType n);
+
 private:
   SphereConvolutionFilter(const SphereConvolutionFilter&); // purposely not implemented
   void operator=(const SphereConvolutionFilter&); //purposely not implemented
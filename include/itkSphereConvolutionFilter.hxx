@@ -22,6 +22,8 @@
 #include "itkSphereConvolutionFilter.h"
 #include "itkImageRegionIteratorWithIndex.h"
 
+#include <algorithm>
+
 namespace itk {
 
 template <class TInputImage, class TOutputImage>
@@ -45,9 +47,43 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
   m_ScanImageFilter->SetScanDimension(2);
   m_ScanImageFilter->SetScanOrderToIncreasing();
 
-  m_TableInterpolator = InterpolatorType::New();
-
   m_LineSampleSpacing = 10; // 10 nm line spacing
+  m_IntersectionRadius = NumericTraits<double>::quiet_NaN();
+
+  m_TableIsRadial = false;
+  m_TableBuffer = NULL;
+  for ( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_TableInverseSpacing[i] = 1.0;
+    m_TableIndexOffset[i] = 0.0;
+    m_TableMaxIndex[i] = 0.0;
+    m_TableMaxBase[i] = 0;
+    m_TableStride[i] = 0;
+    m_TableStep[i] = 0;
+    }
+
+  m_UseRadialSampleTable = false;
+  m_RadialTableSize = 0;
+  m_RadialTableSpacing = 0.0;
+  m_RadialTableRadius = 0.0;
+  m_RadialTableTime = 0;
+
+  m_ConvolutionMethod = LineIntegralConvolution;
+  m_UseFFTConvolution = false;
+  m_FFTSize.Fill(0);
+  m_FFTConvolutionSize.Fill(0);
+  m_FFTConvolutionOrigin.Fill(0.0);
+  m_FFTInverseSpacing.Fill(1.0);
+
+#if defined(ITK_USE_FFTWF)
+  m_FFTBuffer = NULL;
+  m_FFTSpectrum = NULL;
+  m_KernelSpectrum = NULL;
+  m_ForwardPlan = NULL;
+  m_InversePlan = NULL;
+  m_KernelSpectrumSize.Fill(0);
+  m_KernelSpectrumTime = 0;
+#endif
 }
 
 
@@ -55,6 +91,7 @@ template <class TInputImage, class TOutputImage>
 SphereConvolutionFilter<TInputImage,TOutputImage>
 ::~SphereConvolutionFilter()
 {
+  ReleaseFFTData();
 }
 
 
@@ -163,8 +200,29 @@ void
 SphereConvolutionFilter<TInputImage,TOutputImage>
 ::ComputeIntersections()
 {
-  // Clear the intersection list
-  m_IntersectionArray.clear();
+  // The intersections depend only on the radius.
+  if ( m_SphereRadius == m_IntersectionRadius )
+    {
+    return;
+    }
+  m_IntersectionRadius = m_SphereRadius;
+
+  m_IntersectionX.clear();
+  m_IntersectionY.clear();
+  m_IntersectionZ1.clear();
+  m_IntersectionZ2.clear();
+
+  // Reserve room for every line of the sampling grid so that the
+  // arrays are allocated once.
+  SizeValueType lines = 0;
+  if ( m_SphereRadius > 0.0 )
+    {
+    lines = static_cast<SizeValueType>(m_SphereRadius / m_LineSampleSpacing) + 1;
+    }
+  m_IntersectionX.reserve(4*lines*lines + 1);
+  m_IntersectionY.reserve(4*lines*lines + 1);
+  m_IntersectionZ1.reserve(4*lines*lines + 1);
+  m_IntersectionZ2.reserve(4*lines*lines + 1);
 
   // Add intersection at origin point
   AddIntersection(0.0, 0.0);
@@ -194,15 +252,13 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
   unsigned int numIntersections;
   numIntersections = IntersectWithVerticalLine(xs, ys, z1, z2);
 
-  if ( numIntersections > 0 )
+  // A line that only touches the sphere has a zero-length chord.
+  if ( numIntersections == 2 )
     {
-    SphereIntersection intersection;
-    intersection.x = xs;
-    intersection.y = ys;
-    intersection.z1 = z1;
-    intersection.z2 = z2;
-    intersection.numIntersections = numIntersections;
-    m_IntersectionArray.push_back(intersection);
+    m_IntersectionX.push_back(xs);
+    m_IntersectionY.push_back(ys);
+    m_IntersectionZ1.push_back(z1);
+    m_IntersectionZ2.push_back(z2);
     }
 }
 
@@ -212,16 +268,160 @@ void
 SphereConvolutionFilter<TInputImage,TOutputImage>
 ::BeforeThreadedGenerateData()
 {
+  // The table and the FFT convolution are sampled along the axes of
+  // the input.
+  typename InputImageType::DirectionType identity;
+  identity.SetIdentity();
+  if ( this->GetInput()->GetDirection() != identity )
+    {
+    itkExceptionMacro(<< "The input kernel must have an identity direction, but has\n"
+                      << this->GetInput()->GetDirection());
+    }
+
+  // If the input image is one slice thick in the xz-plane, assume
+  // radial interpolation is desired.
+  m_TableIsRadial = this->GetInput()->GetLargestPossibleRegion().GetSize()[1] == 1;
+
+  m_UseFFTConvolution = SelectFFTConvolution();
+  if ( m_UseFFTConvolution )
+    {
+    ComputeFFTConvolution();
+    return;
+    }
+
   // Compute the scan of the convolution kernel.
   m_ScanImageFilter->SetInput(this->GetInput());
   m_ScanImageFilter->UpdateLargestPossibleRegion();
 
-  // Set the inputs for the interpolators
-  m_TableInterpolator->SetInputImage(m_ScanImageFilter->GetOutput());
+  // Sample the pre-integrated table directly from its buffer.
+  const InputImageType *scannedImage = m_ScanImageFilter->GetOutput();
+  const InputImageSizeType tableSize = scannedImage->GetLargestPossibleRegion().GetSize();
+  m_TableBuffer = scannedImage->GetBufferPointer();
+  SizeValueType stride = 1;
+  for ( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    m_TableInverseSpacing[i] = 1.0 / scannedImage->GetSpacing()[i];
+    m_TableIndexOffset[i] = -scannedImage->GetOrigin()[i] * m_TableInverseSpacing[i];
+    m_TableMaxIndex[i] = static_cast<double>(tableSize[i] - 1);
+    m_TableMaxBase[i] = tableSize[i] > 1 ? tableSize[i] - 2 : 0;
+    m_TableStride[i] = stride;
+    m_TableStep[i] = tableSize[i] > 1 ? stride : 0;
+    stride *= tableSize[i];
+    }
 
   // Generate the list of intersections of vertical lines and the
   // sphere.
   ComputeIntersections();
+
+  if ( m_UseRadialSampleTable && m_TableIsRadial )
+    {
+    ComputeRadialSampleTable();
+    }
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ComputeRadialSampleTable()
+{
+  const InputImageType *scannedImage = m_ScanImageFilter->GetOutput();
+
+  // Depths of the samples relative to the sphere center, in the order
+  // ComputeIntegratedRadialVoxelValue() visits them.
+  const SizeValueType samplesZ = m_NumberOfIntegrationSamples[2];
+  const double dz = m_Spacing[2] / static_cast<double>(samplesZ);
+  std::vector<double> sampleZ(m_Size[2] * samplesZ);
+  for ( SizeValueType k = 0; k < m_Size[2]; k++ )
+    {
+    double z = m_Origin[2] + static_cast<double>(k) * m_Spacing[2];
+    if (m_UseCustomZCoordinates)
+      {
+      z = GetZCoordinate(k);
+      }
+    for ( SizeValueType kz = 0; kz < samplesZ; kz++ )
+      {
+      sampleZ[k*samplesZ + kz] = z - (0.5*m_Spacing[2]) + (kz+0.5)*dz - m_SphereCenter[2];
+      }
+    }
+
+  // Beyond the radial extent of the kernel plus the sphere radius no
+  // line reaches the sample, so the table stops there and the last two
+  // entries are zero. The lookup clamps to them, which makes the table
+  // independent of the sphere center in x and y.
+  const double spacing = 0.5 * scannedImage->GetSpacing()[0];
+  double maxDistance = scannedImage->GetOrigin()[0] + m_SphereRadius +
+    (static_cast<double>(scannedImage->GetLargestPossibleRegion().GetSize()[0]) - 0.5) *
+    scannedImage->GetSpacing()[0];
+  if (maxDistance < 0.0)
+    {
+    maxDistance = 0.0;
+    }
+  const SizeValueType size = static_cast<SizeValueType>(ceil(maxDistance / spacing)) + 2;
+
+  if ( !m_RadialSampleTable.empty() &&
+       m_RadialTableTime == scannedImage->GetMTime() &&
+       m_RadialTableRadius == m_SphereRadius &&
+       m_RadialTableSpacing == spacing &&
+       m_RadialTableSize == size &&
+       m_RadialSampleZ == sampleZ )
+    {
+    return;
+    }
+
+  // Invalidate the table until it is complete.
+  m_RadialTableTime = 0;
+
+  m_RadialSampleZ = sampleZ;
+  m_RadialTableSize = size;
+  m_RadialTableSpacing = spacing;
+  m_RadialTableRadius = m_SphereRadius;
+  m_RadialSampleTable.assign(sampleZ.size() * size, 0.0);
+
+  this->GetMultiThreader()->SetNumberOfThreads(this->GetNumberOfThreads());
+  this->GetMultiThreader()->SetSingleMethod(Self::RadialSampleTableThreaderCallback, this);
+  this->GetMultiThreader()->SingleMethodExecute();
+
+  m_RadialTableTime = scannedImage->GetMTime();
+}
+
+
+template <class TInputImage, class TOutputImage>
+ITK_THREAD_RETURN_TYPE
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::RadialSampleTableThreaderCallback(void *arg)
+{
+  MultiThreader::ThreadInfoStruct *info =
+    static_cast<MultiThreader::ThreadInfoStruct *>(arg);
+  Self *filter = static_cast<Self *>(info->UserData);
+
+  filter->ThreadedComputeRadialSampleTable(info->ThreadID, info->NumberOfThreads);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ThreadedComputeRadialSampleTable(ThreadIdType threadId, ThreadIdType numberOfThreads)
+{
+  // Rows are interleaved over the threads to balance the load, rows
+  // far from the sphere are cheaper than the ones through it.
+  const SizeValueType rows = m_RadialSampleZ.size();
+  for ( SizeValueType row = threadId; row < rows; row += numberOfThreads )
+    {
+    double *values = &m_RadialSampleTable[row * m_RadialTableSize];
+
+    OutputImagePointType point(m_SphereCenter);
+    point[2] += m_RadialSampleZ[row];
+    for ( SizeValueType i = 0; i < m_RadialTableSize; i++ )
+      {
+      point[0] = m_SphereCenter[0] + static_cast<double>(i) * m_RadialTableSpacing;
+      point[1] = m_SphereCenter[1];
+      values[i] = ComputeSampleValue(point);
+      }
+    }
 }
 
 
@@ -240,13 +440,18 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
   SpacingType dx;
   double volume = 1.0;
   unsigned int dimension = this->m_WeightIntegrationByArea ? ImageDimension - 1 : ImageDimension;
-  for ( unsigned int i = 0; i < dimension; i++ )
+  for ( unsigned int i = 0; i < ImageDimension; i++ )
     {
     dx[i] = this->GetSpacing()[i]
       / static_cast< SpacingValueType >(m_NumberOfIntegrationSamples[i]);
-    volume *= dx[i];
+    if ( i < dimension )
+      {
+      volume *= dx[i];
+      }
     }
 
+  const bool useRadialSampleTable = m_UseRadialSampleTable && m_TableIsRadial;
+
   for (; !it.IsAtEnd(); ++it)
     {
     OutputImageIndexType index = it.GetIndex();
@@ -263,7 +468,14 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
     point[0] -= m_ShearX * (point[2] - m_SphereCenter[2]);
     point[1] -= m_ShearY * (point[2] - m_SphereCenter[2]);
 
-    it.Set( volume * ComputeIntegratedVoxelValue(point, dx) );
+    if ( useRadialSampleTable )
+      {
+      it.Set( volume * ComputeIntegratedRadialVoxelValue(point, dx, index[2]) );
+      }
+    else
+      {
+      it.Set( volume * ComputeIntegratedVoxelValue(point, dx) );
+      }
     progress.CompletedPixel();
     }
 }
@@ -276,81 +488,144 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
 {
   double value = 0.0f;
 
-  if (m_SphereRadius < 0.0)
+  if ( m_UseFFTConvolution )
     {
-    return value;
+    return ComputeFFTSampleValue(point);
     }
 
-  // Compute maximum z value in the pre-integrated table.
-  InputImagePointer scannedImage = m_ScanImageFilter->GetOutput();
-  double tableZMax = (scannedImage->GetSpacing()[2] *
-              static_cast<double>(scannedImage->GetLargestPossibleRegion().GetSize()[2]-1)) + scannedImage->GetOrigin()[2];
-
-  IntersectionArrayConstIterator iter;
-  for ( IntersectionArrayConstIterator iter = m_IntersectionArray.begin();
-        iter != m_IntersectionArray.end();
-        iter++)
+  const SizeValueType numberOfLines = m_IntersectionX.size();
+  if (m_SphereRadius < 0.0 || numberOfLines == 0)
     {
-    SphereIntersection intersection = *iter;
-    double xs = intersection.x  + m_SphereCenter[0];
-    double ys = intersection.y  + m_SphereCenter[1];
-    double z1 = intersection.z1 + m_SphereCenter[2];
-    double z2 = intersection.z2 + m_SphereCenter[2];
-    int numIntersections = intersection.numIntersections;
+    return value;
+    }
 
-    // Find the intersection z-coordinate values, if they exist.
-    double x = point[0];
-    double y = point[1];
-    double z = point[2];
+  // Sample position relative to the sphere center.
+  const double x = point[0] - m_SphereCenter[0];
+  const double y = point[1] - m_SphereCenter[1];
+  const double z = point[2] - m_SphereCenter[2];
 
-    if (numIntersections == 2)
-      {
-      Point<float, ImageDimension> p1, p2;
-      p1[0] = x - xs;   p1[1] = y - ys;   p1[2] = z - z1;
-      p2[0] = x - xs;   p2[1] = y - ys;   p2[2] = z - z2;
-
-      // If the input image is one slice thick in the xz-plane, assume
-      // radial interpolation is desired and change the lookup table
-      // accordingly.
-      if ( this->GetInput()->GetLargestPossibleRegion().GetSize()[1] == 1 )
-        {
-        double r = sqrt(p2[0]*p2[0] + p2[1]*p2[1]);
-        p1[0] = r; p1[1] = 0.0;
-        p2[0] = r; p2[1] = 0.0;
-        }
+  const double * const xs = &m_IntersectionX[0];
+  const double * const ys = &m_IntersectionY[0];
+  const double * const z1 = &m_IntersectionZ1[0];
+  const double * const z2 = &m_IntersectionZ2[0];
 
-      // Important: z1 is always less than z2, so p1 is always above p2
+  const double invX = m_TableInverseSpacing[0];
+  const double invY = m_TableInverseSpacing[1];
+  const double invZ = m_TableInverseSpacing[2];
+  const double offsetX = m_TableIndexOffset[0];
+  const double offsetY = m_TableIndexOffset[1];
 
-      // Subtract z-voxel spacing from p2[2] to get the proper behavior
-      // in the pre-integrated PSF table.
-      p2[2] -= scannedImage->GetSpacing()[2];
+  // Table z indices of the sample, subtract z-voxel spacing for p2 to
+  // get the proper behavior in the pre-integrated PSF table.
+  const double t1 = z * invZ + m_TableIndexOffset[2];
+  const double t2 = t1 - 1.0;
 
-      // Get values from the pre-integrated table
-      typename InterpolatorType::ContinuousIndexType p1Index, p2Index;
-      bool v1Inside = m_TableInterpolator->GetInputImage()->
-        TransformPhysicalPointToContinuousIndex(p1, p1Index);
-      bool v2Inside = m_TableInterpolator->GetInputImage()->
-        TransformPhysicalPointToContinuousIndex(p2, p2Index);
-      InputImagePixelType v1 = 0.0;
-      InputImagePixelType v2 = 0.0;
-      if (v1Inside) v1 = m_TableInterpolator->EvaluateAtContinuousIndex(p1Index);
-      if (v2Inside) v2 = m_TableInterpolator->EvaluateAtContinuousIndex(p2Index);
+  if ( m_TableIsRadial )
+    {
+    // A radial table is looked up at y = 0.
+    const bool insideY = IsInsideTable(1, offsetY);
+
+    for ( SizeValueType i = 0; i < numberOfLines; i++ )
+      {
+      const double dx = x - xs[i];
+      const double dy = y - ys[i];
+      const double tr  = sqrt(dx*dx + dy*dy) * invX + offsetX;
+      const double tz1 = t1 - z1[i] * invZ;
+      const double tz2 = t2 - z2[i] * invZ;
+
+      // Important: z1 is always less than z2, so p1 is always above p2.
+      // Above the top of the table the clamped lookup returns the top
+      // plane, the integral over the whole kernel.
+      const bool insideXY = insideY && IsInsideTable(0, tr);
+      const bool inside1 = insideXY && IsInsideTable(2, tz1);
+      const bool inside2 = insideXY && IsInsideTable(2, tz2);
+      const double v1 = (inside1 || inside2) ? EvaluateRadialTable(tr, tz1) : 0.0;
+      const double v2 = inside2 ? EvaluateRadialTable(tr, tz2) : 0.0;
 
-      if (!v1Inside && v2Inside && p1[2] > tableZMax)
-        {
-        p1[2] = tableZMax - 1e-5;
-        v1 = m_TableInterpolator->Evaluate(p1);
-        }
       // z - z1 is always larger than z - z2, and integration goes along
       // positive z, so we return v1 - v2.
       value += v1 - v2;
       }
     }
+  else
+    {
+    for ( SizeValueType i = 0; i < numberOfLines; i++ )
+      {
+      const double tx  = (x - xs[i]) * invX + offsetX;
+      const double ty  = (y - ys[i]) * invY + offsetY;
+      const double tz1 = t1 - z1[i] * invZ;
+      const double tz2 = t2 - z2[i] * invZ;
+
+      const bool insideXY = IsInsideTable(0, tx) && IsInsideTable(1, ty);
+      const bool inside1 = insideXY && IsInsideTable(2, tz1);
+      const bool inside2 = insideXY && IsInsideTable(2, tz2);
+      const double v1 = (inside1 || inside2) ? EvaluateTable(tx, ty, tz1) : 0.0;
+      const double v2 = inside2 ? EvaluateTable(tx, ty, tz2) : 0.0;
+
+      value += v1 - v2;
+      }
+    }
 
   return value;
 }
 
 
+template <class TInputImage, class TOutputImage>
+inline double
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::EvaluateTable(double tx, double ty, double tz) const
+{
+  tx = std::min(std::max(tx, 0.0), m_TableMaxIndex[0]);
+  ty = std::min(std::max(ty, 0.0), m_TableMaxIndex[1]);
+  tz = std::min(std::max(tz, 0.0), m_TableMaxIndex[2]);
+  const SizeValueType ix = std::min(static_cast<SizeValueType>(tx), m_TableMaxBase[0]);
+  const SizeValueType iy = std::min(static_cast<SizeValueType>(ty), m_TableMaxBase[1]);
+  const SizeValueType iz = std::min(static_cast<SizeValueType>(tz), m_TableMaxBase[2]);
+  const double fx = tx - static_cast<double>(ix);
+  const double fy = ty - static_cast<double>(iy);
+  const double fz = tz - static_cast<double>(iz);
+
+  const SizeValueType sx = m_TableStep[0];
+  const SizeValueType sy = m_TableStep[1];
+  const SizeValueType sz = m_TableStep[2];
+  const InputImagePixelType *v = m_TableBuffer +
+    iz*m_TableStride[2] + iy*m_TableStride[1] + ix;
+
+  const double v00 = v[0]     + fx*(v[sx]       - v[0]);
+  const double v10 = v[sy]    + fx*(v[sy+sx]    - v[sy]);
+  const double v01 = v[sz]    + fx*(v[sz+sx]    - v[sz]);
+  const double v11 = v[sz+sy] + fx*(v[sz+sy+sx] - v[sz+sy]);
+
+  const double v0 = v00 + fy*(v10 - v00);
+  const double v1 = v01 + fy*(v11 - v01);
+
+  return v0 + fz*(v1 - v0);
+}
+
+
+template <class TInputImage, class TOutputImage>
+inline double
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::EvaluateRadialTable(double tr, double tz) const
+{
+  tr = std::min(std::max(tr, 0.0), m_TableMaxIndex[0]);
+  tz = std::min(std::max(tz, 0.0), m_TableMaxIndex[2]);
+  const SizeValueType ir = std::min(static_cast<SizeValueType>(tr), m_TableMaxBase[0]);
+  const SizeValueType iz = std::min(static_cast<SizeValueType>(tz), m_TableMaxBase[2]);
+  const double fr = tr - static_cast<double>(ir);
+  const double fz = tz - static_cast<double>(iz);
+
+  const SizeValueType sr = m_TableStep[0];
+  const SizeValueType sz = m_TableStep[2];
+  const InputImagePixelType *v = m_TableBuffer + iz*m_TableStride[2] + ir;
+
+  const double v0 = v[0]  + fr*(v[sr]    - v[0]);
+  const double v1 = v[sz] + fr*(v[sz+sr] - v[sz]);
+
+  return v0 + fz*(v1 - v0);
+}
+
+
 template <class TInputImage, class TOutputImage>
 double
 SphereConvolutionFilter<TInputImage,TOutputImage>
@@ -380,6 +655,383 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
 }
 
 
+template <class TInputImage, class TOutputImage>
+double
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ComputeIntegratedRadialVoxelValue(OutputImagePointType& point, const SpacingType& dx,
+                                    SizeValueType zIndex) const
+{
+  double sum = 0.0;
+
+  const SizeValueType samplesZ = m_NumberOfIntegrationSamples[2];
+  const double invSpacing = 1.0 / m_RadialTableSpacing;
+  const double maxIndex = static_cast<double>(m_RadialTableSize - 2);
+
+  // Sample position relative to the sphere axis.
+  const double x0 = point[0] - (0.5*this->GetSpacing()[0]) - m_SphereCenter[0];
+  const double y0 = point[1] - (0.5*this->GetSpacing()[1]) - m_SphereCenter[1];
+
+  for ( SizeValueType k = 0; k < samplesZ; k++ )
+    {
+    const double *values =
+      &m_RadialSampleTable[(zIndex*samplesZ + k) * m_RadialTableSize];
+    for ( SizeValueType j = 0; j < m_NumberOfIntegrationSamples[1]; j++ )
+      {
+      const double y = y0 + (j+0.5)*dx[1];
+      for ( SizeValueType i = 0; i < m_NumberOfIntegrationSamples[0]; i++ )
+        {
+        const double x = x0 + (i+0.5)*dx[0];
+
+        double t = sqrt(x*x + y*y) * invSpacing;
+        if (t > maxIndex)
+          {
+          t = maxIndex;
+          }
+        const SizeValueType ti = static_cast<SizeValueType>(t);
+        const double f = t - static_cast<double>(ti);
+
+        sum += values[ti] + f*(values[ti+1] - values[ti]);
+        }
+      }
+    }
+
+  return sum;
+}
+
+
+template <class TInputImage, class TOutputImage>
+bool
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::SelectFFTConvolution() const
+{
+  if ( m_ConvolutionMethod == LineIntegralConvolution )
+    {
+    return false;
+    }
+
+#if defined(ITK_USE_FFTWF)
+  if ( m_ConvolutionMethod == FFTConvolution )
+    {
+    if ( m_TableIsRadial )
+      {
+      itkExceptionMacro(<< "FFT convolution requires a 3-D kernel, the input is radial.");
+      }
+    return true;
+    }
+
+  const InputImageType *kernel = this->GetInput();
+  const SpacingType &h = kernel->GetSpacing();
+  const InputImageSizeType kernelSize = kernel->GetLargestPossibleRegion().GetSize();
+
+  // The partial-volume raster is too coarse for spheres smaller than a
+  // few kernel voxels.
+  if ( m_TableIsRadial ||
+       m_SphereRadius < 2.0 * std::max(h[0], std::max(h[1], h[2])) )
+    {
+    return false;
+    }
+
+  // Rough operation counts. A line costs two trilinear lookups per
+  // sample, the FFT method costs three real transforms of the padded
+  // grid (one if the kernel spectrum is cached) plus one lookup per
+  // sample.
+  double samples = 1.0;
+  double fftPoints = 1.0;
+  for ( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    samples *= static_cast<double>(m_Size[i] * m_NumberOfIntegrationSamples[i]);
+    SizeValueType margin = static_cast<SizeValueType>(ceil(m_SphereRadius / h[i])) + 1;
+    fftPoints *= static_cast<double>(GetFFTSize(kernelSize[i] + 2*margin));
+    }
+  const double lines = vnl_math::pi * m_SphereRadius * m_SphereRadius /
+    (m_LineSampleSpacing * m_LineSampleSpacing);
+  const double lineCost = 20.0 * lines * samples;
+  const double fftCost = 3.0 * 2.5 * fftPoints * vcl_log(fftPoints) / vnl_math::ln2 +
+    10.0 * samples;
+
+  return fftCost < lineCost;
+#else
+  if ( m_ConvolutionMethod == FFTConvolution )
+    {
+    itkExceptionMacro(<< "FFT convolution requires ITK built with ITK_USE_FFTWF.");
+    }
+  return false;
+#endif
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ComputeFFTConvolution()
+{
+#if defined(ITK_USE_FFTWF)
+  const InputImageType *kernel = this->GetInput();
+  const InputImageSizeType kernelSize = kernel->GetLargestPossibleRegion().GetSize();
+  const SpacingType &h = kernel->GetSpacing();
+  const InputImagePointType &kernelOrigin = kernel->GetOrigin();
+  const double radius = std::max(m_SphereRadius, 0.0);
+
+  // The sphere is rasterized on the kernel grid shifted to the sphere
+  // center, sample a lies at center + (a - margin) * h. The full
+  // linear convolution then lies on the kernel grid shifted by
+  // center - margin * h.
+  SizeValueType margin[ImageDimension];
+  SizeType sphereSize;
+  SizeType fftSize;
+  for ( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+    margin[i] = static_cast<SizeValueType>(ceil(radius / h[i])) + 1;
+    sphereSize[i] = 2*margin[i] + 1;
+    m_FFTConvolutionSize[i] = kernelSize[i] + sphereSize[i] - 1;
+    m_FFTConvolutionOrigin[i] = kernelOrigin[i] + m_SphereCenter[i] -
+      static_cast<double>(margin[i]) * h[i];
+    m_FFTInverseSpacing[i] = 1.0 / h[i];
+    fftSize[i] = GetFFTSize(m_FFTConvolutionSize[i]);
+    }
+
+  const SizeValueType nx = fftSize[0];
+  const SizeValueType ny = fftSize[1];
+  const SizeValueType nz = fftSize[2];
+  const SizeValueType realSize = nx * ny * nz;
+  const SizeValueType complexSize = (nx/2 + 1) * ny * nz;
+
+  if ( fftSize != m_FFTSize )
+    {
+    ReleaseFFTData();
+
+    m_FFTBuffer = static_cast<float *>(fftwf_malloc(realSize * sizeof(float)));
+    m_FFTSpectrum = static_cast<fftwf_complex *>(fftwf_malloc(complexSize * sizeof(fftwf_complex)));
+    m_KernelSpectrum = static_cast<fftwf_complex *>(fftwf_malloc(complexSize * sizeof(fftwf_complex)));
+    if ( m_FFTBuffer == NULL || m_FFTSpectrum == NULL || m_KernelSpectrum == NULL )
+      {
+      ReleaseFFTData();
+      itkExceptionMacro(<< "Could not allocate the FFT convolution buffers of size "
+                        << fftSize << ".");
+      }
+
+    // FFTW_ESTIMATE does not touch the buffers. The proxy serializes
+    // planning with the global FFTW lock shared with ITK's FFT filters.
+    typedef fftw::Proxy< float > FFTWProxyType;
+    m_ForwardPlan = FFTWProxyType::Plan_dft_r2c_3d(nz, ny, nx, m_FFTBuffer, m_FFTSpectrum,
+                                                   FFTW_ESTIMATE);
+    m_InversePlan = FFTWProxyType::Plan_dft_c2r_3d(nz, ny, nx, m_FFTSpectrum, m_FFTBuffer,
+                                                   FFTW_ESTIMATE);
+    if ( m_ForwardPlan == NULL || m_InversePlan == NULL )
+      {
+      ReleaseFFTData();
+      itkExceptionMacro(<< "Could not create the FFTW plans of size " << fftSize << ".");
+      }
+
+    m_FFTSize = fftSize;
+    }
+
+  // Transform the kernel unless its spectrum is still valid.
+  if ( m_KernelSpectrumTime != kernel->GetMTime() || m_KernelSpectrumSize != kernelSize )
+    {
+    const InputImagePixelType *kernelBuffer = kernel->GetBufferPointer();
+    std::fill(m_FFTBuffer, m_FFTBuffer + realSize, 0.0f);
+    for ( SizeValueType k = 0; k < kernelSize[2]; k++ )
+      {
+      for ( SizeValueType j = 0; j < kernelSize[1]; j++ )
+        {
+        const InputImagePixelType *in = kernelBuffer + (k*kernelSize[1] + j)*kernelSize[0];
+        float *out = m_FFTBuffer + (k*ny + j)*nx;
+        for ( SizeValueType i = 0; i < kernelSize[0]; i++ )
+          {
+          out[i] = static_cast<float>(in[i]);
+          }
+        }
+      }
+    fftwf_execute_dft_r2c(m_ForwardPlan, m_FFTBuffer, m_KernelSpectrum);
+    m_KernelSpectrumSize = kernelSize;
+    m_KernelSpectrumTime = kernel->GetMTime();
+    }
+
+  // Rasterize the sphere. The fraction of each voxel inside the sphere
+  // is exact along z and sampled on a 4 x 4 grid in x and y.
+  const unsigned int subsamples = 4;
+  const double r2 = radius * radius;
+  std::fill(m_FFTBuffer, m_FFTBuffer + realSize, 0.0f);
+  for ( SizeValueType k = 0; k < sphereSize[2]; k++ )
+    {
+    const double z = (static_cast<double>(k) - static_cast<double>(margin[2])) * h[2];
+    const double zMin = z - 0.5*h[2];
+    const double zMax = z + 0.5*h[2];
+    for ( SizeValueType j = 0; j < sphereSize[1]; j++ )
+      {
+      const double y = (static_cast<double>(j) - static_cast<double>(margin[1])) * h[1];
+      float *out = m_FFTBuffer + (k*ny + j)*nx;
+      for ( SizeValueType i = 0; i < sphereSize[0]; i++ )
+        {
+        const double x = (static_cast<double>(i) - static_cast<double>(margin[0])) * h[0];
+
+        // Distances from the sphere center to the nearest and the
+        // farthest point of the voxel.
+        double nearest = 0.0, farthest = 0.0;
+        const double c[3] = { x, y, z };
+        for ( unsigned int d = 0; d < ImageDimension; d++ )
+          {
+          const double lo = vcl_abs(c[d]) - 0.5*h[d];
+          const double hi = vcl_abs(c[d]) + 0.5*h[d];
+          if ( lo > 0.0 )
+            {
+            nearest += lo*lo;
+            }
+          farthest += hi*hi;
+          }
+        if ( nearest >= r2 )
+          {
+          continue;
+          }
+        if ( farthest <= r2 )
+          {
+          out[i] = 1.0f;
+          continue;
+          }
+
+        double length = 0.0;
+        for ( unsigned int sy = 0; sy < subsamples; sy++ )
+          {
+          const double ys = y + ((sy + 0.5) / subsamples - 0.5) * h[1];
+          for ( unsigned int sx = 0; sx < subsamples; sx++ )
+            {
+            const double xs = x + ((sx + 0.5) / subsamples - 0.5) * h[0];
+            const double chord2 = r2 - xs*xs - ys*ys;
+            if ( chord2 > 0.0 )
+              {
+              const double chord = sqrt(chord2);
+              const double overlap = std::min(chord, zMax) - std::max(-chord, zMin);
+              if ( overlap > 0.0 )
+                {
+                length += overlap;
+                }
+              }
+            }
+          }
+        out[i] = static_cast<float>(length / (subsamples * subsamples * h[2]));
+        }
+      }
+    }
+
+  fftwf_execute_dft_r2c(m_ForwardPlan, m_FFTBuffer, m_FFTSpectrum);
+
+  // Multiply by the kernel spectrum. The scale undoes the unnormalized
+  // FFTW round trip and matches the line integration, whose samples
+  // are sums over lines m_LineSampleSpacing apart of kernel sums along
+  // z, while a convolution sample is a sum over kernel voxels.
+  const float scale = static_cast<float>
+    (h[0] * h[1] / (m_LineSampleSpacing * m_LineSampleSpacing * static_cast<double>(realSize)));
+  for ( SizeValueType i = 0; i < complexSize; i++ )
+    {
+    const float re = m_FFTSpectrum[i][0]*m_KernelSpectrum[i][0] -
+      m_FFTSpectrum[i][1]*m_KernelSpectrum[i][1];
+    const float im = m_FFTSpectrum[i][0]*m_KernelSpectrum[i][1] +
+      m_FFTSpectrum[i][1]*m_KernelSpectrum[i][0];
+    m_FFTSpectrum[i][0] = scale * re;
+    m_FFTSpectrum[i][1] = scale * im;
+    }
+
+  fftwf_execute_dft_c2r(m_InversePlan, m_FFTSpectrum, m_FFTBuffer);
+#endif
+}
+
+
+template <class TInputImage, class TOutputImage>
+double
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ComputeFFTSampleValue(const OutputImagePointType& point) const
+{
+#if defined(ITK_USE_FFTWF)
+  // Trilinear interpolation, zero outside the convolution.
+  SizeValueType index[3];
+  double        f[3];
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    const double t = (point[d] - m_FFTConvolutionOrigin[d]) * m_FFTInverseSpacing[d];
+    const double maxIndex = static_cast<double>(m_FFTConvolutionSize[d] - 1);
+    if ( t < 0.0 || t > maxIndex )
+      {
+      return 0.0;
+      }
+    index[d] = std::min(static_cast<SizeValueType>(t), m_FFTConvolutionSize[d] - 2);
+    f[d] = t - static_cast<double>(index[d]);
+    }
+
+  const SizeValueType nx = m_FFTSize[0];
+  const SizeValueType planeStride = nx * m_FFTSize[1];
+  const float *v = m_FFTBuffer + index[2]*planeStride + index[1]*nx + index[0];
+
+  const double v00 = v[0]           + f[0]*(v[1]             - v[0]);
+  const double v10 = v[nx]          + f[0]*(v[nx+1]          - v[nx]);
+  const double v01 = v[planeStride] + f[0]*(v[planeStride+1] - v[planeStride]);
+  const double v11 = v[planeStride+nx] +
+    f[0]*(v[planeStride+nx+1] - v[planeStride+nx]);
+
+  const double v0 = v00 + f[1]*(v10 - v00);
+  const double v1 = v01 + f[1]*(v11 - v01);
+
+  return v0 + f[2]*(v1 - v0);
+#else
+  return 0.0;
+#endif
+}
+
+
+template <class TInputImage, class TOutputImage>
+void
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::ReleaseFFTData()
+{
+#if defined(ITK_USE_FFTWF)
+  if ( m_ForwardPlan )
+    {
+    fftw::Proxy< float >::DestroyPlan(m_ForwardPlan);
+    }
+  if ( m_InversePlan )
+    {
+    fftw::Proxy< float >::DestroyPlan(m_InversePlan);
+    }
+  m_ForwardPlan = NULL;
+  m_InversePlan = NULL;
+
+  fftwf_free(m_FFTBuffer);
+  fftwf_free(m_FFTSpectrum);
+  fftwf_free(m_KernelSpectrum);
+  m_FFTBuffer = NULL;
+  m_FFTSpectrum = NULL;
+  m_KernelSpectrum = NULL;
+
+  m_KernelSpectrumTime = 0;
+#endif
+  m_FFTSize.Fill(0);
+}
+
+
+template <class TInputImage, class TOutputImage>
+typename SphereConvolutionFilter<TInputImage,TOutputImage>::SizeValueType
+SphereConvolutionFilter<TInputImage,TOutputImage>
+::GetFFTSize(SizeValueType n)
+{
+  const SizeValueType factors[4] = { 2, 3, 5, 7 };
+  for ( SizeValueType size = std::max(n, static_cast<SizeValueType>(1)); ; size++ )
+    {
+    SizeValueType remainder = size;
+    for ( unsigned int i = 0; i < 4; i++ )
+      {
+      while ( remainder % factors[i] == 0 )
+        {
+        remainder /= factors[i];
+        }
+      }
+    if ( remainder == 1 )
+      {
+      return size;
+      }
+    }
+}
+
+
 template <class TInputImage, class TOutputImage>
 void
 SphereConvolutionFilter<TInputImage,TOutputImage>
@@ -415,6 +1067,8 @@ SphereConvolutionFilter<TInputImage,TOutputImage>
   os << m_SphereCenter[i] << "]" << std::endl;
 
   os << indent << "SphereRadius: " << m_SphereRadius << std::endl;
+  os << indent << "UseRadialSampleTable: " << m_UseRadialSampleTable << std::endl;
+  os << indent << "ConvolutionMethod: " << m_ConvolutionMethod << std::endl;
 
 }
 
@@ -5,6 +5,7 @@ software available from http://cirl.memphis.edu/cosmos.php.")
 itk_module(ITKMicroscopyPSFToolkit
  DEPENDS
   ITKCommon
+  ITKFFT
   ITKImageSources
  TEST_DEPENDS
   ITKTestKernel
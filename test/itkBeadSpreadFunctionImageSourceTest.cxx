@@ -0,0 +1,178 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ *
+ ****************************************************************************/
+
+#include "itkBeadSpreadFunctionImageSource.h"
+#include "itkGibsonLanniCOSMOSPointSpreadFunctionImageSource.h"
+
+#include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkTestingMacros.h"
+
+#include <cstdlib>
+#include <vector>
+
+typedef itk::Image< double, 3 > ImageType;
+
+static void CopyImage( const ImageType * image, std::vector< double > & values )
+{
+  values.clear();
+  itk::ImageRegionConstIterator< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    values.push_back( it.Get() );
+    }
+}
+
+int itkBeadSpreadFunctionImageSourceTest(int argc, char * argv[])
+{
+  if ( argc < 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " <output file name>" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::BeadSpreadFunctionImageSource< ImageType >                   SourceType;
+  typedef itk::GibsonLanniCOSMOSPointSpreadFunctionImageSource< ImageType > KernelSourceType;
+
+  KernelSourceType::Pointer kernelSource = KernelSourceType::New();
+
+  SourceType::Pointer source = SourceType::New();
+  source->SetKernelSource( kernelSource );
+
+  SourceType::SizeType size = {{8, 8, 5}};
+  source->SetSize( size );
+
+  SourceType::SpacingType spacing;
+  spacing[0] = 100.0;
+  spacing[1] = 100.0;
+  spacing[2] = 250.0;
+  source->SetSpacing( spacing );
+
+  SourceType::PointType origin;
+  for (int i = 0; i < ImageType::ImageDimension; ++i)
+    {
+    origin[i] = -0.5 * ( spacing[i] * static_cast< double >(size[i]-1) );
+    }
+  source->SetOrigin( origin );
+
+  source->SetKernelTablePadding( 250.0 );
+  TEST_SET_GET_VALUE( 250.0, source->GetKernelTablePadding() );
+
+  // The bounds of the kernel table stay on the same multiples of the
+  // padding while the bead moves from center to nearbyCenter.
+  SourceType::PointType center;
+  center.Fill( 20.0 );
+  SourceType::PointType nearbyCenter;
+  nearbyCenter.Fill( 40.0 );
+
+  // Moving the bead and growing it regenerates the kernel table on a
+  // different extent. When the bead goes back, the image must be
+  // exactly the one computed before.
+  SourceType::PointType movedCenter( center );
+  movedCenter[0] = 250.0;
+
+  const bool radial[] = { true, false, false };
+  const SourceType::ConvolutionMethodType methods[] = {
+    SourceType::ConvolverType::LineIntegralConvolution,
+    SourceType::ConvolverType::LineIntegralConvolution,
+    SourceType::ConvolverType::FFTConvolution
+  };
+#if defined(ITK_USE_FFTWF)
+  const unsigned int numberOfConfigurations = 3;
+#else
+  const unsigned int numberOfConfigurations = 2;
+#endif
+
+  for ( unsigned int c = 0; c < numberOfConfigurations; ++c )
+    {
+    source->SetKernelIsRadiallySymmetric( radial[c] );
+    source->SetConvolutionMethod( methods[c] );
+    TEST_SET_GET_VALUE( methods[c], source->GetConvolutionMethod() );
+
+    source->SetBeadCenter( center );
+    source->SetBeadRadius( 100.0 );
+    source->Update();
+
+    std::vector< double > expected;
+    CopyImage( source->GetOutput(), expected );
+
+    // Changing the intensity must only rerun the rescaling.
+    const unsigned long kernelTime = kernelSource->GetMTime();
+    const unsigned long kernelOutputTime = kernelSource->GetOutput()->GetMTime();
+    const unsigned long convolverOutputTime = source->GetConvolver()->GetOutput()->GetMTime();
+    source->SetIntensityScale( 2.0 );
+    source->Update();
+    if ( kernelSource->GetMTime() != kernelTime ||
+         kernelSource->GetOutput()->GetMTime() != kernelOutputTime ||
+         source->GetConvolver()->GetOutput()->GetMTime() != convolverOutputTime )
+      {
+      std::cerr << "Configuration " << c << ": changing the intensity "
+                << "modified the kernel or reran the convolution" << std::endl;
+      return EXIT_FAILURE;
+      }
+    source->SetIntensityScale( 1.0 );
+
+    // A small move of the bead must keep the kernel and rerun only the
+    // convolution.
+    source->SetBeadCenter( nearbyCenter );
+    source->Update();
+    if ( kernelSource->GetMTime() != kernelTime ||
+         kernelSource->GetOutput()->GetMTime() != kernelOutputTime )
+      {
+      std::cerr << "Configuration " << c << ": moving the bead by 20 nm "
+                << "modified the kernel" << std::endl;
+      return EXIT_FAILURE;
+      }
+    if ( source->GetConvolver()->GetOutput()->GetMTime() == convolverOutputTime )
+      {
+      std::cerr << "Configuration " << c << ": moving the bead did not "
+                << "rerun the convolution" << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    source->SetBeadCenter( movedCenter );
+    source->SetBeadRadius( 250.0 );
+    source->Update();
+
+    source->SetBeadCenter( center );
+    source->SetBeadRadius( 100.0 );
+    source->Update();
+
+    std::vector< double > computed;
+    CopyImage( source->GetOutput(), computed );
+    for ( size_t i = 0; i < expected.size(); ++i )
+      {
+      if ( computed[i] != expected[i] )
+        {
+        std::cerr << "Configuration " << c << ": regenerated kernel table gave "
+                  << computed[i] << " at offset " << i << ", expected "
+                  << expected[i] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  typedef itk::ImageFileWriter< ImageType > WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetFileName( argv[1] );
+  writer->SetInput( source->GetOutput() );
+  writer->Update();
+
+  return EXIT_SUCCESS;
+}
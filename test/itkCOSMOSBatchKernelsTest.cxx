@@ -0,0 +1,118 @@
+/****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307  USA
+ *
+ ****************************************************************************/
+
+#include "psf/functor.h"
+#include "psf/bessel0nr.h"
+#include "psf/bessel012nr.h"
+#include "psf/sinCos.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Compares the batch Bessel kernels with libm on [-100, 100].
+template< class T >
+bool TestBesselKernels(const char * typeName, double tolerance)
+{
+  const int n = 20001;
+  std::vector< T > x( n );
+  std::vector< T > batchJ0( n );
+  std::vector< T > batchJ1( n );
+  std::vector< T > batchJ2( n );
+  std::vector< T > batchJ0nr( n );
+  for ( int i = 0; i < n; ++i )
+    {
+    x[i] = static_cast< T >( -100.0 + 200.0 * i / ( n - 1 ) );
+    }
+
+  cosm::J012nr< T > j012;
+  j012( &x[0], &batchJ0[0], &batchJ1[0], &batchJ2[0], n );
+  cosm::J0nr< T > j0Functor;
+  j0Functor.evaluate( &x[0], &batchJ0nr[0], n );
+
+  double maxError[4] = { 0.0, 0.0, 0.0, 0.0 };
+  for ( int i = 0; i < n; ++i )
+    {
+    const double xi = x[i];
+    maxError[0] = std::max( maxError[0], std::abs( batchJ0[i] - j0( xi ) ) );
+    maxError[1] = std::max( maxError[1], std::abs( batchJ1[i] - j1( xi ) ) );
+    maxError[2] = std::max( maxError[2], std::abs( batchJ2[i] - jn( 2, xi ) ) );
+    maxError[3] = std::max( maxError[3], std::abs( batchJ0nr[i] - j0( xi ) ) );
+    }
+
+  const char * names[4] = { "J012nr J0", "J012nr J1", "J012nr J2", "J0nr" };
+  bool passed = true;
+  for ( int k = 0; k < 4; ++k )
+    {
+    if ( maxError[k] > tolerance )
+      {
+      std::cerr << names[k] << "<" << typeName << "> differs from libm by "
+                << maxError[k] << ", expected at most " << tolerance
+                << std::endl;
+      passed = false;
+      }
+    }
+  return passed;
+}
+
+// Compares sinCos() with libm on [-range, range].
+template< class T >
+bool TestSinCos(const char * typeName, double range, double tolerance)
+{
+  const int n = 200001;
+  double maxError = 0.0;
+  for ( int i = 0; i < n; ++i )
+    {
+    const T x = static_cast< T >( -range + 2.0 * range * i / ( n - 1 ) );
+    T s;
+    T c;
+    cosm::sinCos( x, s, c );
+    const double xd = x;
+    maxError = std::max( maxError, std::abs( s - std::sin( xd ) ) );
+    maxError = std::max( maxError, std::abs( c - std::cos( xd ) ) );
+    }
+
+  if ( maxError > tolerance )
+    {
+    std::cerr << "sinCos<" << typeName << "> differs from libm on [-"
+              << range << ", " << range << "] by " << maxError
+              << ", expected at most " << tolerance << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int itkCOSMOSBatchKernelsTest(int, char * [])
+{
+  bool passed = true;
+
+  // The rational fits are accurate to about 5e-9 in double precision.
+  passed &= TestBesselKernels< double >( "double", 1e-8 );
+  passed &= TestBesselKernels< float >( "float", 5e-6 );
+
+  // The reduction is done in double for both types.
+  passed &= TestSinCos< double >( "double", 1e3, 1e-15 );
+  passed &= TestSinCos< double >( "double", 1e6, 1e-15 );
+  passed &= TestSinCos< float >( "float", 1e3, 2e-7 );
+  passed &= TestSinCos< float >( "float", 1e6, 2e-7 );
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -20,10 +20,32 @@
 #include "itkGibsonLanniCOSMOSPointSpreadFunctionImageSource.h"
 
 #include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
 #include "itkTestingMacros.h"
+#include "itksys/SystemTools.hxx"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
+typedef itk::Image< double, 3 > TestImageType;
+
+// Exposes the thread split so that the test can count the planes each
+// thread computes.
+class InspectableGibsonLanniSource :
+  public itk::GibsonLanniCOSMOSPointSpreadFunctionImageSource< TestImageType >
+{
+public:
+  typedef InspectableGibsonLanniSource                                          Self;
+  typedef itk::GibsonLanniCOSMOSPointSpreadFunctionImageSource< TestImageType > Superclass;
+  typedef itk::SmartPointer< Self >                                             Pointer;
+
+  itkNewMacro(Self);
+
+  using Superclass::IsMirroredPlane;
+  using Superclass::SplitRequestedRegion;
+};
+
 int itkGibsonLanniCOSMOSPointSpreadFunctionImageSourceTest(int argc, char * argv[])
 {
   if ( argc < 2 )
@@ -58,6 +80,228 @@ int itkGibsonLanniCOSMOSPointSpreadFunctionImageSourceTest(int argc, char * argv
   writer->SetInput( source->GetOutput() );
   writer->Update();
 
+  // Evaluating the model at every voxel must give exactly the same
+  // image as evaluating it once per distinct radius.
+  ImageType::Pointer uniqueRadiiImage = source->GetOutput();
+  uniqueRadiiImage->DisconnectPipeline();
+
+  source->DeduplicateRadiiOff();
+  source->Update();
+
+  typedef itk::ImageRegionConstIterator< ImageType > IteratorType;
+  IteratorType uniqueIt( uniqueRadiiImage,
+                         uniqueRadiiImage->GetLargestPossibleRegion() );
+  IteratorType voxelIt( source->GetOutput(),
+                        source->GetOutput()->GetLargestPossibleRegion() );
+  for ( ; !uniqueIt.IsAtEnd(); ++uniqueIt, ++voxelIt )
+    {
+    if ( uniqueIt.Get() != voxelIt.Get() )
+      {
+      std::cerr << "Deduplicated radii gave " << uniqueIt.Get()
+                << " at index " << uniqueIt.GetIndex() << ", expected "
+                << voxelIt.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  ImageType::Pointer dqagImage = source->GetOutput();
+  dqagImage->DisconnectPipeline();
+
+  // The default parameters are symmetric about the focal plane, so the
+  // planes at negative z were mirrored. Computing them must agree.
+  source->UseZSymmetryOff();
+  source->Update();
+
+  IteratorType mirroredIt( dqagImage, dqagImage->GetLargestPossibleRegion() );
+  IteratorType computedIt( source->GetOutput(),
+                           source->GetOutput()->GetLargestPossibleRegion() );
+  for ( ; !mirroredIt.IsAtEnd(); ++mirroredIt, ++computedIt )
+    {
+    if ( std::abs( mirroredIt.Get() - computedIt.Get() ) > 1e-6 * std::abs( computedIt.Get() ) + 1e-12 )
+      {
+      std::cerr << "Mirrored plane gave " << mirroredIt.Get()
+                << " at index " << mirroredIt.GetIndex() << ", expected "
+                << computedIt.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  source->UseZSymmetryOn();
+
+  // Half of the planes are mirrored, so splitting the planes evenly
+  // would leave some threads idle. Every thread must get the same
+  // number of computed planes, give or take one.
+  InspectableGibsonLanniSource::Pointer splitSource = InspectableGibsonLanniSource::New();
+  SourceType::SizeType splitSize = {{8, 8, 16}};
+  splitSource->SetSize( splitSize );
+  splitSource->SetSpacing( spacing );
+  splitSource->SetOrigin( origin );
+  splitSource->SetIntegrationMethod( SourceType::FunctorType::INTEGRATION_GAUSS_LEGENDRE );
+  splitSource->Update();
+
+  for ( unsigned int numberOfThreads = 2; numberOfThreads <= 5; ++numberOfThreads )
+    {
+    ImageType::RegionType splitRegion;
+    const unsigned int numberOfPieces =
+      splitSource->SplitRequestedRegion( 0, numberOfThreads, splitRegion );
+    long minimumPlanes = splitSize[2];
+    long maximumPlanes = 0;
+    long totalPlanes = 0;
+    long mirroredPlanes = 0;
+    for ( unsigned int i = 0; i < numberOfPieces; ++i )
+      {
+      splitSource->SplitRequestedRegion( i, numberOfThreads, splitRegion );
+      long computedPlanes = 0;
+      for ( unsigned int k = 0; k < splitRegion.GetSize( 2 ); ++k )
+        {
+        if ( splitSource->IsMirroredPlane( splitRegion.GetIndex( 2 ) + k ) )
+          {
+          ++mirroredPlanes;
+          }
+        else
+          {
+          ++computedPlanes;
+          }
+        }
+      minimumPlanes = std::min( minimumPlanes, computedPlanes );
+      maximumPlanes = std::max( maximumPlanes, computedPlanes );
+      totalPlanes += splitRegion.GetSize( 2 );
+      }
+    if ( numberOfPieces != numberOfThreads || mirroredPlanes == 0 ||
+         totalPlanes != static_cast< long >( splitSize[2] ) ||
+         minimumPlanes == 0 || maximumPlanes - minimumPlanes > 1 )
+      {
+      std::cerr << "Splitting for " << numberOfThreads << " threads gave "
+                << numberOfPieces << " pieces with " << minimumPlanes
+                << " to " << maximumPlanes << " computed planes ("
+                << mirroredPlanes << " mirrored planes, " << totalPlanes
+                << " planes in total)" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // The adaptive Gauss-Legendre quadrature must agree with dqag.
+  source->SetIntegrationMethod( SourceType::FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE );
+  TEST_SET_GET_VALUE( SourceType::FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE,
+                      source->GetIntegrationMethod() );
+  source->Update();
+
+  IteratorType dqagIt( dqagImage, dqagImage->GetLargestPossibleRegion() );
+  IteratorType gaussIt( source->GetOutput(),
+                        source->GetOutput()->GetLargestPossibleRegion() );
+  double maxValue = 0.0;
+  double maxDifference = 0.0;
+  for ( ; !dqagIt.IsAtEnd(); ++dqagIt, ++gaussIt )
+    {
+    maxValue = std::max( maxValue, dqagIt.Get() );
+    maxDifference = std::max( maxDifference,
+                              std::abs( dqagIt.Get() - gaussIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-4 * maxValue )
+    {
+    std::cerr << "Gauss-Legendre integration differs from dqag by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The single-precision model must agree with dqag as well.
+  source->UseSinglePrecisionOn();
+  source->Update();
+
+  IteratorType singleIt( source->GetOutput(),
+                         source->GetOutput()->GetLargestPossibleRegion() );
+  maxDifference = 0.0;
+  for ( dqagIt.GoToBegin(); !dqagIt.IsAtEnd(); ++dqagIt, ++singleIt )
+    {
+    maxDifference = std::max( maxDifference,
+                              std::abs( dqagIt.Get() - singleIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-4 * maxValue )
+    {
+    std::cerr << "Single-precision model differs from dqag by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  source->UseSinglePrecisionOff();
+
+  // Deep in the specimen the integrand oscillates much faster. Both
+  // Gauss-Legendre methods must still agree with dqag there.
+  source->SetActualPointSourceDepthInSpecimenLayer( 50.0 );
+  source->SetIntegrationMethod( SourceType::FunctorType::INTEGRATION_DQAG );
+  source->Update();
+
+  ImageType::Pointer deepImage = source->GetOutput();
+  deepImage->DisconnectPipeline();
+
+  const SourceType::IntegrationMethodType gaussMethods[] = {
+    SourceType::FunctorType::INTEGRATION_GAUSS_LEGENDRE,
+    SourceType::FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE
+  };
+  for ( unsigned int m = 0; m < 2; ++m )
+    {
+    source->SetIntegrationMethod( gaussMethods[m] );
+    source->Update();
+
+    IteratorType deepIt( deepImage, deepImage->GetLargestPossibleRegion() );
+    IteratorType deepGaussIt( source->GetOutput(),
+                              source->GetOutput()->GetLargestPossibleRegion() );
+    double deepMaxValue = 0.0;
+    maxDifference = 0.0;
+    for ( ; !deepIt.IsAtEnd(); ++deepIt, ++deepGaussIt )
+      {
+      deepMaxValue = std::max( deepMaxValue, deepIt.Get() );
+      maxDifference = std::max( maxDifference,
+                                std::abs( deepIt.Get() - deepGaussIt.Get() ) );
+      }
+
+    if ( maxDifference > 1e-4 * deepMaxValue )
+      {
+      std::cerr << "Gauss-Legendre integration " << gaussMethods[m]
+                << " differs from dqag at 50 um depth by " << maxDifference
+                << " (maximum value " << deepMaxValue << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  source->SetActualPointSourceDepthInSpecimenLayer( 0.0 );
+  source->SetIntegrationMethod( SourceType::FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE );
+  source->Update();
+
+  // A second source with the same parameters must read the image
+  // stored in the cache by the first one.
+  std::string cacheDirectory =
+    itksys::SystemTools::GetFilenamePath( argv[1] ) + "/GibsonLanniCache";
+  itksys::SystemTools::RemoveADirectory( cacheDirectory.c_str() );
+  source->SetCacheDirectory( cacheDirectory );
+  source->Update();
+
+  SourceType::Pointer cachedSource = SourceType::New();
+  cachedSource->SetSize( size );
+  cachedSource->SetSpacing( spacing );
+  cachedSource->SetOrigin( origin );
+  cachedSource->SetIntegrationMethod( SourceType::FunctorType::INTEGRATION_ADAPTIVE_GAUSS_LEGENDRE );
+  cachedSource->SetCacheDirectory( cacheDirectory );
+  cachedSource->Update();
+
+  IteratorType storedIt( source->GetOutput(),
+                         source->GetOutput()->GetLargestPossibleRegion() );
+  IteratorType cachedIt( cachedSource->GetOutput(),
+                         cachedSource->GetOutput()->GetLargestPossibleRegion() );
+  for ( ; !storedIt.IsAtEnd(); ++storedIt, ++cachedIt )
+    {
+    if ( storedIt.Get() != cachedIt.Get() )
+      {
+      std::cerr << "Cached image has " << cachedIt.Get() << " at index "
+                << cachedIt.GetIndex() << ", expected " << storedIt.Get()
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  itksys::SystemTools::RemoveADirectory( cacheDirectory.c_str() );
+
   // Now exercise the setters/getters
   // Check that the number of parameters is what we expect
   TEST_SET_GET_VALUE( 15, source->GetNumberOfParameters() );
@@ -20,9 +20,15 @@
 #include "itkHaeberleCOSMOSPointSpreadFunctionImageSource.h"
 
 #include "itkImageFileWriter.h"
+#include "itkImageRegionConstIterator.h"
 #include "itkTestingMacros.h"
 
+#include "psf/haeberlePsfFunctor.h"
+
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <vector>
 
 int itkHaeberleCOSMOSPointSpreadFunctionImageSourceTest(int argc, char * argv[])
 {
@@ -58,5 +64,265 @@ int itkHaeberleCOSMOSPointSpreadFunctionImageSourceTest(int argc, char * argv[])
   writer->SetInput( source->GetOutput() );
   writer->Update();
 
+  // Keep the directly integrated image around to compare against the
+  // image interpolated from radial profiles.
+  ImageType::Pointer exactImage = source->GetOutput();
+  exactImage->DisconnectPipeline();
+
+  source->UseRadialInterpolationOn();
+  source->SetRadialSampleSpacing( 10.0 );
+  source->Update();
+
+  typedef itk::ImageRegionConstIterator< ImageType > IteratorType;
+  IteratorType exactIt( exactImage, exactImage->GetLargestPossibleRegion() );
+  IteratorType radialIt( source->GetOutput(),
+                         source->GetOutput()->GetLargestPossibleRegion() );
+  double maxValue = 0.0;
+  double maxDifference = 0.0;
+  for ( ; !exactIt.IsAtEnd(); ++exactIt, ++radialIt )
+    {
+    maxValue = std::max( maxValue, exactIt.Get() );
+    maxDifference = std::max( maxDifference,
+                              std::abs( exactIt.Get() - radialIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-2 * maxValue )
+    {
+    std::cerr << "Radial interpolation differs from direct integration by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // With the y and z axes swapped a plane spans many z values, so the
+  // radial profiles cannot be used and every voxel must be integrated.
+  ImageType::DirectionType direction;
+  direction.Fill( 0.0 );
+  direction[0][0] = 1.0;
+  direction[1][2] = -1.0;
+  direction[2][1] = 1.0;
+  source->SetDirection( direction );
+  source->Update();
+
+  ImageType::Pointer rotatedRadialImage = source->GetOutput();
+  rotatedRadialImage->DisconnectPipeline();
+
+  source->UseRadialInterpolationOff();
+  source->Update();
+
+  IteratorType rotatedRadialIt( rotatedRadialImage,
+                                rotatedRadialImage->GetLargestPossibleRegion() );
+  IteratorType rotatedIt( source->GetOutput(),
+                          source->GetOutput()->GetLargestPossibleRegion() );
+  for ( ; !rotatedIt.IsAtEnd(); ++rotatedRadialIt, ++rotatedIt )
+    {
+    if ( rotatedRadialIt.Get() != rotatedIt.Get() )
+      {
+      std::cerr << "Radial interpolation was used with a rotated direction, "
+                << "got " << rotatedRadialIt.Get() << " at index "
+                << rotatedIt.GetIndex() << ", expected " << rotatedIt.Get()
+                << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  direction.SetIdentity();
+  source->SetDirection( direction );
+
+  // The surrogate must reproduce the directly integrated image.
+  source->UseSurrogateOn();
+  source->SetSurrogateTolerance( 1e-4 );
+  source->Update();
+
+  IteratorType surrogateIt( source->GetOutput(),
+                            source->GetOutput()->GetLargestPossibleRegion() );
+  maxDifference = 0.0;
+  for ( exactIt.GoToBegin(); !exactIt.IsAtEnd(); ++exactIt, ++surrogateIt )
+    {
+    maxDifference = std::max( maxDifference,
+                              std::abs( exactIt.Get() - surrogateIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-3 * maxValue )
+    {
+    std::cerr << "Surrogate differs from direct integration by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Moving the functors between depths must give the same images as
+  // creating them for each depth.
+  source->UseSurrogateOff();
+  std::vector< double > depths;
+  depths.push_back( 0.0 );
+  depths.push_back( 5.0 );
+  std::vector< ImageType::Pointer > stack = source->GenerateDepthStack( depths );
+
+  SourceType::Pointer depthSource = SourceType::New();
+  depthSource->SetSize( size );
+  depthSource->SetSpacing( spacing );
+  depthSource->SetOrigin( origin );
+  depthSource->SetActualPointSourceDepthInSpecimenLayer( depths[1] );
+  depthSource->Update();
+
+  IteratorType firstIt( stack[0], stack[0]->GetLargestPossibleRegion() );
+  IteratorType secondIt( stack[1], stack[1]->GetLargestPossibleRegion() );
+  IteratorType depthIt( depthSource->GetOutput(),
+                        depthSource->GetOutput()->GetLargestPossibleRegion() );
+  maxDifference = 0.0;
+  for ( exactIt.GoToBegin(); !exactIt.IsAtEnd(); ++exactIt, ++firstIt, ++secondIt, ++depthIt )
+    {
+    maxDifference = std::max( maxDifference,
+                              std::abs( exactIt.Get() - firstIt.Get() ) );
+    maxDifference = std::max( maxDifference,
+                              std::abs( depthIt.Get() - secondIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-9 * maxValue )
+    {
+    std::cerr << "Depth stack differs from direct integration by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The functor integrates I0, I1 and I2 as one complex integral by
+  // default. It must agree with the six separate real integrals it
+  // replaced, compared along the x axis of every plane.
+  cosm::HaeberlePsfFunctor< double > singlePassFunctor(
+    1e-3*depths[0],
+    1e-3*source->GetDesignImmersionOilThickness(),
+    1e-3*source->GetDesignImmersionOilThickness(),
+    1e-3*source->GetDesignCoverSlipThickness(),
+    1e-3*source->GetActualCoverSlipThickness(),
+    source->GetActualSpecimenLayerRefractiveIndex(),
+    source->GetDesignImmersionOilRefractiveIndex(),
+    source->GetActualImmersionOilRefractiveIndex(),
+    source->GetDesignCoverSlipRefractiveIndex(),
+    source->GetActualCoverSlipRefractiveIndex(),
+    160.0, 160.0,
+    source->GetMagnification(),
+    source->GetNumericalAperture(),
+    1e-6*source->GetEmissionWavelength(),
+    1e-6 );
+  cosm::HaeberlePsfFunctor< double > sixPassFunctor(
+    1e-3*depths[0],
+    1e-3*source->GetDesignImmersionOilThickness(),
+    1e-3*source->GetDesignImmersionOilThickness(),
+    1e-3*source->GetDesignCoverSlipThickness(),
+    1e-3*source->GetActualCoverSlipThickness(),
+    source->GetActualSpecimenLayerRefractiveIndex(),
+    source->GetDesignImmersionOilRefractiveIndex(),
+    source->GetActualImmersionOilRefractiveIndex(),
+    source->GetDesignCoverSlipRefractiveIndex(),
+    source->GetActualCoverSlipRefractiveIndex(),
+    160.0, 160.0,
+    source->GetMagnification(),
+    source->GetNumericalAperture(),
+    1e-6*source->GetEmissionWavelength(),
+    1e-6 );
+  sixPassFunctor.singlePass( false );
+
+  for ( size_t d = 0; d < depths.size(); ++d )
+    {
+    singlePassFunctor.depth( 1e-3*depths[d] );
+    sixPassFunctor.depth( 1e-3*depths[d] );
+
+    double sixPassMax = 0.0;
+    maxDifference = 0.0;
+    for ( unsigned int k = 0; k < size[2]; ++k )
+      {
+      double z = 1e-6 * ( origin[2] + k * spacing[2] );
+      for ( unsigned int i = 0; i < size[0]; ++i )
+        {
+        double r = 1e-6 * std::abs( origin[0] + i * spacing[0] );
+        double singlePassValue = std::norm( singlePassFunctor( z, r ) );
+        double sixPassValue = std::norm( sixPassFunctor( z, r ) );
+        sixPassMax = std::max( sixPassMax, sixPassValue );
+        maxDifference = std::max( maxDifference,
+                                  std::abs( singlePassValue - sixPassValue ) );
+        }
+      }
+
+    if ( maxDifference > 1e-3 * sixPassMax )
+      {
+      std::cerr << "Single pass integration at depth " << depths[d]
+                << " differs from six pass integration by " << maxDifference
+                << " (maximum value " << sixPassMax << ")" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // A spectrum with the emission wavelength only is monochromatic.
+  std::vector< double > wavelengths( 1, source->GetEmissionWavelength() );
+  std::vector< double > weights( 1, 2.0 );
+  source->SetEmissionSpectrum( wavelengths, weights );
+  source->Update();
+
+  IteratorType spectralIt( source->GetOutput(),
+                           source->GetOutput()->GetLargestPossibleRegion() );
+  maxDifference = 0.0;
+  for ( exactIt.GoToBegin(); !exactIt.IsAtEnd(); ++exactIt, ++spectralIt )
+    {
+    maxDifference = std::max( maxDifference,
+                              std::abs( exactIt.Get() - spectralIt.Get() ) );
+    }
+
+  if ( maxDifference > 1e-9 * maxValue )
+    {
+    std::cerr << "Single wavelength spectrum differs from direct integration by "
+              << maxDifference << " (maximum value " << maxValue << ")"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A spectrum with several wavelengths is the weighted sum of the
+  // monochromatic images at these wavelengths.
+  wavelengths.clear();
+  wavelengths.push_back( 500.0 );
+  wavelengths.push_back( 600.0 );
+  weights.clear();
+  weights.push_back( 1.0 );
+  weights.push_back( 3.0 );
+  source->SetEmissionSpectrum( wavelengths, weights );
+  source->Update();
+
+  std::vector< ImageType::Pointer > monochromaticImages;
+  for ( size_t i = 0; i < wavelengths.size(); ++i )
+    {
+    SourceType::Pointer monochromaticSource = SourceType::New();
+    monochromaticSource->SetSize( size );
+    monochromaticSource->SetSpacing( spacing );
+    monochromaticSource->SetOrigin( origin );
+    monochromaticSource->SetEmissionWavelength( wavelengths[i] );
+    monochromaticSource->Update();
+    monochromaticImages.push_back( monochromaticSource->GetOutput() );
+    }
+
+  IteratorType spectrumIt( source->GetOutput(),
+                           source->GetOutput()->GetLargestPossibleRegion() );
+  IteratorType shortIt( monochromaticImages[0],
+                        monochromaticImages[0]->GetLargestPossibleRegion() );
+  IteratorType longIt( monochromaticImages[1],
+                       monochromaticImages[1]->GetLargestPossibleRegion() );
+  double weightedMax = 0.0;
+  maxDifference = 0.0;
+  for ( ; !spectrumIt.IsAtEnd(); ++spectrumIt, ++shortIt, ++longIt )
+    {
+    const double weighted = 0.25 * shortIt.Get() + 0.75 * longIt.Get();
+    weightedMax = std::max( weightedMax, weighted );
+    maxDifference = std::max( maxDifference,
+                              std::abs( spectrumIt.Get() - weighted ) );
+    }
+
+  if ( maxDifference > 1e-9 * weightedMax )
+    {
+    std::cerr << "Two wavelength spectrum differs from the weighted "
+              << "monochromatic images by " << maxDifference
+              << " (maximum value " << weightedMax << ")" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   return EXIT_SUCCESS;
 }